@@ -45,6 +45,15 @@
 #include <ctype.h>
 #include <float.h>
 
+/* vectorized scanning of strings and whitespace, with a scalar fallback */
+#if defined(__GNUC__) && defined(__AVX2__)
+#define CJSON_SIMD_AVX2
+#include <immintrin.h>
+#elif defined(__GNUC__) && defined(__SSE2__)
+#define CJSON_SIMD_SSE2
+#include <emmintrin.h>
+#endif
+
 #ifdef ENABLE_LOCALES
 #include <locale.h>
 #endif
@@ -153,6 +162,23 @@ static int case_insensitive_strcmp(const unsigned char *string1, const unsigned
     return tolower(*string1) - tolower(*string2);
 }
 
+/* FNV-1a hash of an object key with ASCII letters folded to lower case, so that it serves both
+ * case sensitive and case insensitive lookups. Never returns 0, which marks an unknown hash. */
+static unsigned int hash_key(const unsigned char *key)
+{
+    unsigned int hash = 2166136261u;
+    for (; *key != '\0'; key++)
+    {
+        unsigned char c = *key;
+        if ((c >= 'A') && (c <= 'Z'))
+        {
+            c = (unsigned char)(c + ('a' - 'A'));
+        }
+        hash = (hash ^ c) * 16777619u;
+    }
+    return (hash != 0) ? hash : 1;
+}
+
 typedef struct internal_hooks
 {
     void *(CJSON_CDECL *allocate)(size_t size);
@@ -183,7 +209,20 @@ static void * CJSON_CDECL internal_realloc(void *pointer, size_t size)
 /* strlen of character literals resolved at compile time */
 #define static_strlen(string_literal) (sizeof(string_literal) - sizeof(""))
 
-static internal_hooks global_hooks = { internal_malloc, internal_free, internal_realloc };
+/* the hooks are thread local, see cJSON_InitHooks */
+#ifndef CJSON_THREAD_LOCAL
+#if defined(__STDC_VERSION__) && (__STDC_VERSION__ >= 201112L)
+#define CJSON_THREAD_LOCAL _Thread_local
+#elif defined(__GNUC__)
+#define CJSON_THREAD_LOCAL __thread
+#elif defined(_MSC_VER)
+#define CJSON_THREAD_LOCAL __declspec(thread)
+#else
+#define CJSON_THREAD_LOCAL
+#endif
+#endif
+
+static CJSON_THREAD_LOCAL internal_hooks global_hooks = { internal_malloc, internal_free, internal_realloc };
 
 static unsigned char* cJSON_strdup(const unsigned char* string, const internal_hooks * const hooks)
 {
@@ -303,13 +342,214 @@ typedef struct
 /* get a pointer to the buffer at the position */
 #define buffer_at_offset(buffer) ((buffer)->content + (buffer)->offset)
 
+/* Find the first byte equal to a or b in [input, end), returns end if there is none.
+ * Scans 32 (AVX2) or 16 (SSE2) bytes at a time, never reading past end. */
+static const unsigned char *find_either_byte(const unsigned char *input, const unsigned char *end, unsigned char a, unsigned char b)
+{
+#if defined(CJSON_SIMD_AVX2)
+    const __m256i a32 = _mm256_set1_epi8((char)a);
+    const __m256i b32 = _mm256_set1_epi8((char)b);
+    while ((end - input) >= 32)
+    {
+        __m256i chunk = _mm256_loadu_si256((const __m256i *)(const void *)input);
+        unsigned int mask = (unsigned int)_mm256_movemask_epi8(_mm256_or_si256(
+                _mm256_cmpeq_epi8(chunk, a32), _mm256_cmpeq_epi8(chunk, b32)));
+        if (mask != 0)
+        {
+            return input + __builtin_ctz(mask);
+        }
+        input += 32;
+    }
+#endif
+#if defined(CJSON_SIMD_AVX2) || defined(CJSON_SIMD_SSE2)
+    {
+        const __m128i a16 = _mm_set1_epi8((char)a);
+        const __m128i b16 = _mm_set1_epi8((char)b);
+        while ((end - input) >= 16)
+        {
+            __m128i chunk = _mm_loadu_si128((const __m128i *)(const void *)input);
+            unsigned int mask = (unsigned int)_mm_movemask_epi8(_mm_or_si128(
+                    _mm_cmpeq_epi8(chunk, a16), _mm_cmpeq_epi8(chunk, b16)));
+            if (mask != 0)
+            {
+                return input + __builtin_ctz(mask);
+            }
+            input += 16;
+        }
+    }
+#endif
+    while ((input < end) && (*input != a) && (*input != b))
+    {
+        input++;
+    }
+    return input;
+}
+
+/* Find the first byte > 32 (not whitespace or a control character) in [input, end), returns end if there is none. */
+static const unsigned char *skip_whitespace_run(const unsigned char *input, const unsigned char *end)
+{
+    /* most runs are only a few bytes long (separators, indentation), don't pay for a vector load on those */
+    const unsigned char *scalar_end = ((end - input) > 4) ? input + 4 : end;
+    while (input < scalar_end)
+    {
+        if (*input > 32)
+        {
+            return input;
+        }
+        input++;
+    }
+#if defined(CJSON_SIMD_AVX2) || defined(CJSON_SIMD_SSE2)
+    {
+        /* a byte is <= 32 exactly when max(byte, 32) == 32 */
+        const __m128i space = _mm_set1_epi8(32);
+        while ((end - input) >= 16)
+        {
+            __m128i chunk = _mm_loadu_si128((const __m128i *)(const void *)input);
+            unsigned int mask = (unsigned int)_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_max_epu8(chunk, space), space));
+            if (mask != 0xFFFF)
+            {
+                return input + __builtin_ctz(~mask);
+            }
+            input += 16;
+        }
+    }
+#endif
+    while ((input < end) && (*input <= 32))
+    {
+        input++;
+    }
+    return input;
+}
+
+/* powers of ten that are exactly representable as a double */
+static const double exact_powers_of_ten[] = {
+    1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+#define MAX_EXACT_POWER_OF_TEN 22
+#define MAX_EXACT_INTEGER 9007199254740992.0 /* 2^53 */
+
+/* Parse a number without strtod. This succeeds for numbers with at most 19 significant
+ * digits that can be converted with a single correctly rounded operation: an integer,
+ * or a mantissa of at most 2^53 multiplied or divided by an exact power of ten
+ * (Clinger's fast path). Returns the number of bytes consumed, or 0 if the number
+ * has to go through strtod. Accepts the same syntax strtod does for the characters
+ * parse_number lets through. */
+static size_t parse_number_fast(const unsigned char * const input, const size_t length, double * const number)
+{
+    size_t i = 0;
+    size_t exponent_start = 0;
+    unsigned long long mantissa = 0;
+    int significant_digits = 0;
+    int exponent = 0;
+    int explicit_exponent = 0;
+    cJSON_bool negative = false;
+    cJSON_bool exponent_negative = false;
+    cJSON_bool has_digits = false;
+    double value = 0;
+
+    if ((i < length) && ((input[i] == '-') || (input[i] == '+')))
+    {
+        negative = (input[i] == '-');
+        i++;
+    }
+
+    for (; (i < length) && (input[i] >= '0') && (input[i] <= '9'); i++)
+    {
+        if (significant_digits == 19)
+        {
+            return 0;
+        }
+        mantissa = mantissa * 10 + (unsigned long long)(input[i] - '0');
+        if (mantissa != 0)
+        {
+            significant_digits++;
+        }
+        has_digits = true;
+    }
+
+    if ((i < length) && (input[i] == '.'))
+    {
+        for (i++; (i < length) && (input[i] >= '0') && (input[i] <= '9'); i++)
+        {
+            if (significant_digits == 19)
+            {
+                return 0;
+            }
+            mantissa = mantissa * 10 + (unsigned long long)(input[i] - '0');
+            if (mantissa != 0)
+            {
+                significant_digits++;
+            }
+            exponent--;
+            has_digits = true;
+        }
+    }
+
+    if (!has_digits)
+    {
+        return 0;
+    }
+
+    /* the exponent is only part of the number if at least one digit follows */
+    if ((i < length) && ((input[i] == 'e') || (input[i] == 'E')))
+    {
+        exponent_start = i + 1;
+        if ((exponent_start < length) && ((input[exponent_start] == '-') || (input[exponent_start] == '+')))
+        {
+            exponent_negative = (input[exponent_start] == '-');
+            exponent_start++;
+        }
+        if ((exponent_start < length) && (input[exponent_start] >= '0') && (input[exponent_start] <= '9'))
+        {
+            for (i = exponent_start; (i < length) && (input[i] >= '0') && (input[i] <= '9'); i++)
+            {
+                if (explicit_exponent < 10000)
+                {
+                    explicit_exponent = explicit_exponent * 10 + (input[i] - '0');
+                }
+            }
+            exponent += exponent_negative ? -explicit_exponent : explicit_exponent;
+        }
+    }
+
+    if ((mantissa == 0) || (exponent == 0))
+    {
+        /* converting a 64 bit integer to double is correctly rounded */
+        value = (double)mantissa;
+    }
+#if !defined(FLT_EVAL_METHOD) || (FLT_EVAL_METHOD == 0)
+    else if (((double)mantissa <= MAX_EXACT_INTEGER) && (exponent >= -MAX_EXACT_POWER_OF_TEN) && (exponent <= MAX_EXACT_POWER_OF_TEN))
+    {
+        /* both operands are exact, so the result is correctly rounded */
+        if (exponent < 0)
+        {
+            value = (double)mantissa / exact_powers_of_ten[-exponent];
+        }
+        else
+        {
+            value = (double)mantissa * exact_powers_of_ten[exponent];
+        }
+    }
+#endif
+    else
+    {
+        return 0;
+    }
+
+    *number = negative ? -value : value;
+    return i;
+}
+
 /* Parse the input text to generate a number, and populate the result into item. */
 static cJSON_bool parse_number(cJSON * const item, parse_buffer * const input_buffer)
 {
     double number = 0;
     unsigned char *after_end = NULL;
     unsigned char number_c_string[64];
-    unsigned char decimal_point = get_decimal_point();
+    unsigned char decimal_point = 0;
+    size_t length = 0;
     size_t i = 0;
 
     if ((input_buffer == NULL) || (input_buffer->content == NULL))
@@ -317,6 +557,14 @@ static cJSON_bool parse_number(cJSON * const item, parse_buffer * const input_bu
         return false;
     }
 
+    length = parse_number_fast(buffer_at_offset(input_buffer), input_buffer->length - input_buffer->offset, &number);
+    if (length != 0)
+    {
+        goto number_end;
+    }
+
+    decimal_point = get_decimal_point();
+
     /* copy the number into a temporary buffer and replace '.' with the decimal point
      * of the current locale (for strtod)
      * This also takes care of '\0' not necessarily being available for marking the end of the input */
@@ -357,7 +605,9 @@ loop_end:
     {
         return false; /* parse_error */
     }
+    length = (size_t)(after_end - number_c_string);
 
+number_end:
     item->valuedouble = number;
 
     /* use saturation in case of overflow */
@@ -376,7 +626,7 @@ loop_end:
 
     item->type = cJSON_Number;
 
-    input_buffer->offset += (size_t)(after_end - number_c_string);
+    input_buffer->offset += length;
     return true;
 }
 
@@ -560,6 +810,96 @@ static cJSON_bool compare_double(double a, double b)
     return (fabs(a - b) <= maxVal * DBL_EPSILON);
 }
 
+/* write value in decimal without a terminator, returns the number of digits */
+static int print_digits(unsigned char * const buffer, unsigned long long value)
+{
+    unsigned char digits[20];
+    int length = 0;
+    int i = 0;
+
+    do
+    {
+        digits[length++] = (unsigned char)('0' + (value % 10));
+        value /= 10;
+    } while (value != 0);
+
+    for (i = 0; i < length; i++)
+    {
+        buffer[i] = digits[length - 1 - i];
+    }
+
+    return length;
+}
+
+/* Print d in fixed notation with as few fraction digits as round-trip. Tries each
+ * count k of fraction digits in turn and accepts the first integer m with
+ * m / 10^k == d; since m is at most 2^53 and 10^k is exact, that division is the
+ * same correctly rounded operation parse_number_fast does, so the output parses
+ * back to d. Returns the length, or 0 if d needs exponent notation or more than
+ * 16 significant digits. Output matches "%1.15g" whenever that round-trips. */
+static int print_decimal(unsigned char * const buffer, const double d)
+{
+    double magnitude = fabs(d);
+    double scaled = 0;
+    unsigned long long mantissa = 0;
+    unsigned char digits[20];
+    int digit_count = 0;
+    int length = 0;
+    int k = 0;
+    int i = 0;
+
+    /* "%g" switches to exponent notation outside of this range */
+    if ((magnitude < 1e-4) || (magnitude >= 1e15))
+    {
+        return 0;
+    }
+
+    for (k = 1; k <= MAX_EXACT_POWER_OF_TEN; k++)
+    {
+        scaled = magnitude * exact_powers_of_ten[k];
+        if (scaled >= MAX_EXACT_INTEGER)
+        {
+            return 0;
+        }
+        mantissa = (unsigned long long)(scaled + 0.5);
+        if (((double)mantissa / exact_powers_of_ten[k]) == magnitude)
+        {
+            break;
+        }
+    }
+    if (k > MAX_EXACT_POWER_OF_TEN)
+    {
+        return 0;
+    }
+
+    if (d < 0)
+    {
+        buffer[length++] = '-';
+    }
+    digit_count = print_digits(digits, mantissa);
+    if (digit_count <= k)
+    {
+        buffer[length++] = '0';
+        buffer[length++] = '.';
+        for (i = digit_count; i < k; i++)
+        {
+            buffer[length++] = '0';
+        }
+        memcpy(buffer + length, digits, (size_t)digit_count);
+        length += digit_count;
+    }
+    else
+    {
+        memcpy(buffer + length, digits, (size_t)(digit_count - k));
+        length += digit_count - k;
+        buffer[length++] = '.';
+        memcpy(buffer + length, digits + digit_count - k, (size_t)k);
+        length += k;
+    }
+
+    return length;
+}
+
 /* Render the number nicely from the given item into a string. */
 static cJSON_bool print_number(const cJSON * const item, printbuffer * const output_buffer)
 {
@@ -570,6 +910,7 @@ static cJSON_bool print_number(const cJSON * const item, printbuffer * const out
     unsigned char number_buffer[26] = {0}; /* temporary buffer to print the number into */
     unsigned char decimal_point = get_decimal_point();
     double test = 0.0;
+    int precision = 0;
 
     if (output_buffer == NULL)
     {
@@ -581,19 +922,34 @@ static cJSON_bool print_number(const cJSON * const item, printbuffer * const out
     {
         length = sprintf((char*)number_buffer, "null");
     }
-    else if(d == (double)item->valueint)
+    else if ((d > -1e15) && (d < 1e15) && (d == (double)(long long)d))
+    {
+        /* integers that "%g" would print without an exponent */
+        length = 0;
+        if (d < 0)
+        {
+            number_buffer[length++] = '-';
+        }
+        length += print_digits(number_buffer + length, (unsigned long long)fabs(d));
+    }
+    else if ((length = print_decimal(number_buffer, d)) != 0)
     {
-        length = sprintf((char*)number_buffer, "%d", item->valueint);
+        /* printed without sprintf */
     }
     else
     {
-        /* Try 15 decimal places of precision to avoid nonsignificant nonzero digits */
-        length = sprintf((char*)number_buffer, "%1.15g", d);
-
-        /* Check whether the original double can be recovered */
-        if ((sscanf((char*)number_buffer, "%lg", &test) != 1) || !compare_double((double)test, d))
+        /* Use the fewest of 15, 16 or 17 significant digits that recovers the original
+         * double exactly; 17 digits always do */
+        for (precision = 15; precision < 17; precision++)
+        {
+            length = sprintf((char*)number_buffer, "%1.*g", precision, d);
+            if ((sscanf((char*)number_buffer, "%lg", &test) == 1) && ((double)test == d))
+            {
+                break;
+            }
+        }
+        if (precision == 17)
         {
-            /* If not, print with 17 decimal places of precision */
             length = sprintf((char*)number_buffer, "%1.17g", d);
         }
     }
@@ -795,6 +1151,7 @@ static cJSON_bool parse_string(cJSON * const item, parse_buffer * const input_bu
     const unsigned char *input_end = buffer_at_offset(input_buffer) + 1;
     unsigned char *output_pointer = NULL;
     unsigned char *output = NULL;
+    size_t skipped_bytes = 0;
 
     /* not a string */
     if (buffer_at_offset(input_buffer)[0] != '\"')
@@ -805,21 +1162,17 @@ static cJSON_bool parse_string(cJSON * const item, parse_buffer * const input_bu
     {
         /* calculate approximate size of the output (overestimate) */
         size_t allocation_length = 0;
-        size_t skipped_bytes = 0;
-        while (((size_t)(input_end - input_buffer->content) < input_buffer->length) && (*input_end != '\"'))
+        const unsigned char *content_end = input_buffer->content + input_buffer->length;
+        while (((input_end = find_either_byte(input_end, content_end, '\"', '\\')) < content_end) && (*input_end != '\"'))
         {
             /* is escape sequence */
-            if (input_end[0] == '\\')
+            if ((input_end + 1) >= content_end)
             {
-                if ((size_t)(input_end + 1 - input_buffer->content) >= input_buffer->length)
-                {
-                    /* prevent buffer overflow when last input character is a backslash */
-                    goto fail;
-                }
-                skipped_bytes++;
-                input_end++;
+                /* prevent buffer overflow when last input character is a backslash */
+                goto fail;
             }
-            input_end++;
+            skipped_bytes++;
+            input_end += 2;
         }
         if (((size_t)(input_end - input_buffer->content) >= input_buffer->length) || (*input_end != '\"'))
         {
@@ -836,12 +1189,23 @@ static cJSON_bool parse_string(cJSON * const item, parse_buffer * const input_bu
     }
 
     output_pointer = output;
+    if (skipped_bytes == 0)
+    {
+        /* no escape sequences, the common case */
+        memcpy(output_pointer, input_pointer, (size_t)(input_end - input_pointer));
+        output_pointer += input_end - input_pointer;
+        input_pointer = input_end;
+    }
     /* loop through the string literal */
     while (input_pointer < input_end)
     {
         if (*input_pointer != '\\')
         {
-            *output_pointer++ = *input_pointer++;
+            /* copy everything up to the next escape sequence at once */
+            const unsigned char *run_end = find_either_byte(input_pointer, input_end, '\\', '\\');
+            memcpy(output_pointer, input_pointer, (size_t)(run_end - input_pointer));
+            output_pointer += run_end - input_pointer;
+            input_pointer = run_end;
         }
         /* escape sequence */
         else
@@ -1067,9 +1431,9 @@ static parse_buffer *buffer_skip_whitespace(parse_buffer * const buffer)
         return buffer;
     }
 
-    while (can_access_at_index(buffer, 0) && (buffer_at_offset(buffer)[0] <= 32))
+    if (buffer_at_offset(buffer)[0] <= 32)
     {
-       buffer->offset++;
+        buffer->offset = (size_t)(skip_whitespace_run(buffer_at_offset(buffer), buffer->content + buffer->length) - buffer->content);
     }
 
     if (buffer->offset == buffer->length)
@@ -1202,8 +1566,294 @@ CJSON_PUBLIC(cJSON *) cJSON_ParseWithLength(const char *value, size_t buffer_len
     return cJSON_ParseWithLengthOpts(value, buffer_length, 0, 0);
 }
 
+/* Documents: a parsed tree whose nodes and strings are bump-allocated from a chain of slabs.
+ * The document header lives at the start of its first slab, so a small message costs a
+ * single slab. Deleting the document hands the slabs back to a per-thread cache instead of
+ * walking the tree, so in steady state parsing and freeing a document does not call malloc. */
+#define DOCUMENT_SLAB_SIZE 4096
+#define DOCUMENT_ALIGN 16
+#define DOCUMENT_CACHED_SLABS 16
+
+typedef struct document_slab
+{
+    struct document_slab *next;
+    size_t size; /* usable bytes after the header */
+    size_t used;
+} document_slab;
+
+#define DOCUMENT_SLAB_HEADER ((sizeof(document_slab) + DOCUMENT_ALIGN - 1) & ~(size_t)(DOCUMENT_ALIGN - 1))
+
+struct cJSON_Document
+{
+    cJSON *root;
+    document_slab *slabs; /* the slab currently allocated from comes first */
+};
+
+/* slabs of DOCUMENT_SLAB_SIZE freed on this thread, ready for reuse. Like the thread print
+ * buffer they come from malloc, independent of the hooks. */
+static CJSON_THREAD_LOCAL document_slab *cached_slabs = NULL;
+static CJSON_THREAD_LOCAL size_t cached_slab_count = 0;
+
+/* the document being parsed on this thread, used by the document hooks */
+static CJSON_THREAD_LOCAL cJSON_Document *parsing_document = NULL;
+
+static document_slab *document_slab_new(size_t size)
+{
+    document_slab *slab = NULL;
+
+    if ((size <= DOCUMENT_SLAB_SIZE) && (cached_slabs != NULL))
+    {
+        slab = cached_slabs;
+        cached_slabs = slab->next;
+        cached_slab_count--;
+    }
+    else
+    {
+        size = (size > DOCUMENT_SLAB_SIZE) ? size : DOCUMENT_SLAB_SIZE;
+        slab = (document_slab*)internal_malloc(DOCUMENT_SLAB_HEADER + size);
+        if (slab == NULL)
+        {
+            return NULL;
+        }
+        slab->size = size;
+    }
+    slab->next = NULL;
+    slab->used = 0;
+
+    return slab;
+}
+
+static void *document_allocate(cJSON_Document * const document, size_t size)
+{
+    document_slab *slab = document->slabs;
+    void *pointer = NULL;
+
+    size = (size + DOCUMENT_ALIGN - 1) & ~(size_t)(DOCUMENT_ALIGN - 1);
+    if ((slab == NULL) || (slab->size - slab->used < size))
+    {
+        slab = document_slab_new(size);
+        if (slab == NULL)
+        {
+            return NULL;
+        }
+        slab->next = document->slabs;
+        document->slabs = slab;
+    }
+
+    pointer = (unsigned char*)slab + DOCUMENT_SLAB_HEADER + slab->used;
+    slab->used += size;
+
+    return pointer;
+}
+
+static void * CJSON_CDECL document_hook_allocate(size_t size)
+{
+    return document_allocate(parsing_document, size);
+}
+
+static void CJSON_CDECL document_hook_deallocate(void *pointer)
+{
+    /* freed together with the document */
+    (void)pointer;
+}
+
+CJSON_PUBLIC(cJSON_Document *) cJSON_ParseDocument(const char *value, size_t buffer_length)
+{
+    internal_hooks saved_hooks = global_hooks;
+    cJSON_Document *document = NULL;
+    document_slab *slab = NULL;
+
+    /* the document header is the first allocation in its first slab */
+    slab = document_slab_new(sizeof(cJSON_Document));
+    if (slab == NULL)
+    {
+        return NULL;
+    }
+    document = (cJSON_Document*)((unsigned char*)slab + DOCUMENT_SLAB_HEADER);
+    document->root = NULL;
+    document->slabs = slab;
+    slab->used = (sizeof(cJSON_Document) + DOCUMENT_ALIGN - 1) & ~(size_t)(DOCUMENT_ALIGN - 1);
+
+    /* The hooks are thread local, so swapping them routes every allocation of this parse
+     * (including the cleanup of a failed parse) into the document without affecting other threads. */
+    parsing_document = document;
+    global_hooks.allocate = document_hook_allocate;
+    global_hooks.deallocate = document_hook_deallocate;
+    global_hooks.reallocate = NULL;
+    document->root = cJSON_ParseWithLength(value, buffer_length);
+    global_hooks = saved_hooks;
+    parsing_document = NULL;
+
+    if (document->root == NULL)
+    {
+        cJSON_DeleteDocument(document);
+        return NULL;
+    }
+
+    return document;
+}
+
+CJSON_PUBLIC(cJSON *) cJSON_DocumentRoot(const cJSON_Document *document)
+{
+    return (document != NULL) ? document->root : NULL;
+}
+
+CJSON_PUBLIC(void) cJSON_DeleteDocument(cJSON_Document *document)
+{
+    document_slab *slab = NULL;
+    document_slab *next = NULL;
+
+    if (document == NULL)
+    {
+        return;
+    }
+
+    /* the document header lives in one of these slabs, so read the list first */
+    for (slab = document->slabs; slab != NULL; slab = next)
+    {
+        next = slab->next;
+        if ((slab->size == DOCUMENT_SLAB_SIZE) && (cached_slab_count < DOCUMENT_CACHED_SLABS))
+        {
+            slab->next = cached_slabs;
+            cached_slabs = slab;
+            cached_slab_count++;
+        }
+        else
+        {
+            internal_free(slab);
+        }
+    }
+}
+
+CJSON_PUBLIC(void) cJSON_FreeDocumentCache(void)
+{
+    document_slab *next = NULL;
+
+    while (cached_slabs != NULL)
+    {
+        next = cached_slabs->next;
+        internal_free(cached_slabs);
+        cached_slabs = next;
+    }
+    cached_slab_count = 0;
+}
+
 #define cjson_min(a, b) (((a) < (b)) ? (a) : (b))
 
+/* length of a string as print_string_ptr renders it, including the quotes */
+static size_t printed_string_length(const unsigned char * const input)
+{
+    const unsigned char *input_pointer = NULL;
+    size_t length = sizeof("\"\"") - sizeof("");
+
+    if (input == NULL)
+    {
+        return length;
+    }
+
+    for (input_pointer = input; *input_pointer; input_pointer++)
+    {
+        switch (*input_pointer)
+        {
+            case '\"':
+            case '\\':
+            case '\b':
+            case '\f':
+            case '\n':
+            case '\r':
+            case '\t':
+                /* one character escape sequence */
+                length += 2;
+                break;
+            default:
+                /* UTF-16 escape sequence uXXXX for control characters */
+                length += (*input_pointer < 32) ? 6 : 1;
+                break;
+        }
+    }
+
+    return length;
+}
+
+/* Compute the exact length print_value produces for item at the given nesting depth,
+ * without the terminator. Mirrors print_value, print_array and print_object.
+ * Returns 0 if item can't be printed. */
+static size_t printed_length(const cJSON * const item, const cJSON_bool format, const size_t depth)
+{
+    const cJSON *child = NULL;
+    size_t length = 0;
+    size_t child_length = 0;
+
+    switch ((item->type) & 0xFF)
+    {
+        case cJSON_NULL:
+            return static_strlen("null");
+
+        case cJSON_False:
+            return static_strlen("false");
+
+        case cJSON_True:
+            return static_strlen("true");
+
+        case cJSON_Number:
+        {
+            /* numbers are short, print them into a scratch buffer */
+            unsigned char number_buffer[32];
+            printbuffer scratch = { 0, 0, 0, 0, 0, 0, { 0, 0, 0 } };
+            scratch.buffer = number_buffer;
+            scratch.length = sizeof(number_buffer);
+            scratch.noalloc = true;
+            if (!print_number(item, &scratch))
+            {
+                return 0;
+            }
+            return scratch.offset;
+        }
+
+        case cJSON_Raw:
+            return (item->valuestring == NULL) ? 0 : strlen(item->valuestring);
+
+        case cJSON_String:
+            return printed_string_length((unsigned char*)item->valuestring);
+
+        case cJSON_Array:
+            /* "[" elements separated by "," or ", " "]" */
+            length = 2;
+            for (child = item->child; child != NULL; child = child->next)
+            {
+                child_length = printed_length(child, format, depth + 1);
+                if (child_length == 0)
+                {
+                    return 0;
+                }
+                length += child_length + (child->next ? (format ? 2 : 1) : 0);
+            }
+            return length;
+
+        case cJSON_Object:
+            /* "{" "\n"? then per member: tabs? key ":" "\t"? value ","? "\n"?, then tabs? "}" */
+            length = 2 + (format ? 1 + depth : 0);
+            for (child = item->child; child != NULL; child = child->next)
+            {
+                child_length = printed_length(child, format, depth + 1);
+                if (child_length == 0)
+                {
+                    return 0;
+                }
+                length += (format ? depth + 1 : 0)
+                    + printed_string_length((unsigned char*)child->string)
+                    + (format ? 2 : 1)
+                    + child_length
+                    + (child->next ? 1 : 0)
+                    + (format ? 1 : 0);
+            }
+            return length;
+
+        default:
+            return 0;
+    }
+}
+
 static unsigned char *print(const cJSON * const item, cJSON_bool format, const internal_hooks * const hooks)
 {
     static const size_t default_buffer_size = 256;
@@ -1332,6 +1982,89 @@ CJSON_PUBLIC(cJSON_bool) cJSON_PrintPreallocated(cJSON *item, char *buffer, cons
     return print_value(item, &p);
 }
 
+CJSON_PUBLIC(size_t) cJSON_PrintedLength(const cJSON *item, cJSON_bool format)
+{
+    if (item == NULL)
+    {
+        return 0;
+    }
+
+    return printed_length(item, format, 0);
+}
+
+/* ensure() wants a few bytes beyond the terminator, reserve them up front for exact sizing */
+#define THREAD_PRINT_SLACK 8
+#define THREAD_PRINT_INITIAL 256
+
+/* The per-thread print buffer is always allocated with malloc, because it outlives any
+ * arena installed through cJSON_InitHooks. */
+static CJSON_THREAD_LOCAL unsigned char *thread_print_buffer = NULL;
+static CJSON_THREAD_LOCAL size_t thread_print_length = 0;
+
+CJSON_PUBLIC(const char *) cJSON_PrintThreadBuffer(const cJSON *item, cJSON_bool format, cJSON_bool exact_size, size_t *length)
+{
+    internal_hooks hooks = { internal_malloc, internal_free, internal_realloc };
+    printbuffer p = { 0, 0, 0, 0, 0, 0, { 0, 0, 0 } };
+    size_t needed = THREAD_PRINT_INITIAL;
+    cJSON_bool printed = false;
+
+    if (item == NULL)
+    {
+        return NULL;
+    }
+
+    if (exact_size)
+    {
+        needed = cJSON_PrintedLength(item, format);
+        if (needed == 0)
+        {
+            return NULL;
+        }
+        needed += THREAD_PRINT_SLACK;
+    }
+
+    if (needed > thread_print_length)
+    {
+        unsigned char *buffer = (unsigned char*)internal_realloc(thread_print_buffer, needed);
+        if (buffer == NULL)
+        {
+            return NULL;
+        }
+        thread_print_buffer = buffer;
+        thread_print_length = needed;
+    }
+
+    /* with exact sizing ensure() never grows the buffer, otherwise it doubles it on demand */
+    p.buffer = thread_print_buffer;
+    p.length = thread_print_length;
+    p.format = format;
+    p.hooks = hooks;
+    printed = print_value(item, &p);
+
+    /* ensure() may have moved the buffer, or freed it if growing failed */
+    thread_print_buffer = p.buffer;
+    thread_print_length = p.length;
+    if (!printed)
+    {
+        return NULL;
+    }
+
+    update_offset(&p);
+    if (length != NULL)
+    {
+        *length = p.offset;
+    }
+
+    return (const char*)p.buffer;
+}
+
+CJSON_PUBLIC(void) cJSON_FreeThreadBuffer(void)
+{
+    internal_free(thread_print_buffer);
+    thread_print_buffer = NULL;
+    thread_print_length = 0;
+}
+
 /* Parser core - when encountering text, process appropriately. */
 static cJSON_bool parse_value(cJSON * const item, parse_buffer * const input_buffer)
 {
@@ -1694,6 +2427,7 @@ static cJSON_bool parse_object(cJSON * const item, parse_buffer * const input_bu
 
         /* swap valuestring and string, because we parsed the name */
         current_item->string = current_item->valuestring;
+        current_item->string_hash = hash_key((const unsigned char*)current_item->string);
         current_item->valuestring = NULL;
 
         if (cannot_access_at_index(input_buffer, 0) || (buffer_at_offset(input_buffer)[0] != ':'))
@@ -1909,23 +2643,30 @@ CJSON_PUBLIC(cJSON *) cJSON_GetArrayItem(const cJSON *array, int index)
 static cJSON *get_object_item(const cJSON * const object, const char * const name, const cJSON_bool case_sensitive)
 {
     cJSON *current_element = NULL;
+    unsigned int name_hash = 0;
 
     if ((object == NULL) || (name == NULL))
     {
         return NULL;
     }
 
+    /* keys with a different hash can't match, only compare strings when the hashes are equal (or unknown) */
+    name_hash = hash_key((const unsigned char*)name);
     current_element = object->child;
     if (case_sensitive)
     {
-        while ((current_element != NULL) && (current_element->string != NULL) && (strcmp(name, current_element->string) != 0))
+        while ((current_element != NULL) && (current_element->string != NULL) &&
+               (((current_element->string_hash != 0) && (current_element->string_hash != name_hash)) ||
+                (strcmp(name, current_element->string) != 0)))
         {
             current_element = current_element->next;
         }
     }
     else
     {
-        while ((current_element != NULL) && (case_insensitive_strcmp((const unsigned char*)name, (const unsigned char*)(current_element->string)) != 0))
+        while ((current_element != NULL) &&
+               (((current_element->string_hash != 0) && (current_element->string_hash != name_hash)) ||
+                (case_insensitive_strcmp((const unsigned char*)name, (const unsigned char*)(current_element->string)) != 0)))
         {
             current_element = current_element->next;
         }
@@ -1977,6 +2718,7 @@ static cJSON *create_reference(const cJSON *item, const internal_hooks * const h
 
     memcpy(reference, item, sizeof(cJSON));
     reference->string = NULL;
+    reference->string_hash = 0;
     reference->type |= cJSON_IsReference;
     reference->next = reference->prev = NULL;
     return reference;
@@ -2069,6 +2811,7 @@ static cJSON_bool add_item_to_object(cJSON * const object, const char * const st
     }
 
     item->string = new_key;
+    item->string_hash = hash_key((const unsigned char*)new_key);
     item->type = new_type;
 
     return add_item_to_array(object, item);
@@ -2399,6 +3142,7 @@ static cJSON_bool replace_item_in_object(cJSON *object, const char *string, cJSO
     {
         return false;
     }
+    replacement->string_hash = hash_key((const unsigned char*)replacement->string);
 
     replacement->type &= ~cJSON_StringIsConst;
 
@@ -2781,6 +3525,7 @@ cJSON * cJSON_Duplicate_rec(const cJSON *item, size_t depth, cJSON_bool recurse)
         {
             goto fail;
         }
+        newitem->string_hash = item->string_hash;
     }
     /* If non-recursive, then we're done! */
     if (!recurse)
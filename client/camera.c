@@ -0,0 +1,214 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "camera.h"
+
+#define TEST_IMAGE_DATA "JPEG TEST IMAGE DATA"
+#define SYNTHETIC_DEFAULT_BYTES (96 * 1024)  // 1280x720、质量80左右的JPEG
+#define SYNTHETIC_WIDTH 1280
+#define SYNTHETIC_HEIGHT 720
+#define SYNTHETIC_HEADER_MAX 256
+
+struct CameraSource {
+    const char *name;
+    size_t max_bytes;
+    long (*capture)(CameraSource *source, char *data, size_t capacity);
+    size_t mean_bytes;  // synthetic：扫描数据的平均长度
+    uint64_t rng;
+};
+
+// 原来的模拟拍摄，实际应用中这里调用摄像头API
+static long capture_test(CameraSource *source, char *data, size_t capacity) {
+    (void)source;
+    size_t len = strlen(TEST_IMAGE_DATA);
+    if (len > capacity) {
+        return -1;
+    }
+    memcpy(data, TEST_IMAGE_DATA, len);
+    return (long)len;
+}
+
+static uint64_t next_random(CameraSource *source) {
+    // xorshift64*，只用于生成看起来像熵编码数据的字节
+    uint64_t x = source->rng;
+    x ^= x >> 12;
+    x ^= x << 25;
+    x ^= x >> 27;
+    source->rng = x;
+    return x * 0x2545F4914F6CDD1DULL;
+}
+
+static size_t put_marker(char *out, size_t pos, uint8_t marker, const uint8_t *body, size_t body_len) {
+    uint8_t *p = (uint8_t *)out + pos;
+    p[0] = 0xFF;
+    p[1] = marker;
+    p[2] = (uint8_t)((body_len + 2) >> 8);
+    p[3] = (uint8_t)(body_len + 2);
+    memcpy(p + 4, body, body_len);
+    return pos + 4 + body_len;
+}
+
+// 生成一帧结构与真实JPEG相同的图像：文件头、两个量化表、帧头、扫描头，
+// 扫描数据为随机字节并按JPEG规则在 0xFF 后填充 0x00，长度在平均值上下 15% 浮动
+static long capture_synthetic(CameraSource *source, char *data, size_t capacity) {
+    static const uint8_t jfif[] = { 'J', 'F', 'I', 'F', 0, 1, 1, 0, 0, 1, 0, 1, 0, 0 };
+    static const uint8_t sof[] = { 8, SYNTHETIC_HEIGHT >> 8, SYNTHETIC_HEIGHT & 0xFF,
+                                   SYNTHETIC_WIDTH >> 8, SYNTHETIC_WIDTH & 0xFF,
+                                   3, 1, 0x22, 0, 2, 0x11, 1, 3, 0x11, 1 };
+    static const uint8_t sos[] = { 3, 1, 0x00, 2, 0x11, 3, 0x11, 0, 63, 0 };
+    uint8_t dqt[2 * 65];
+    for (int t = 0; t < 2; t++) {
+        dqt[t * 65] = (uint8_t)t;
+        for (int i = 0; i < 64; i++) {
+            dqt[t * 65 + 1 + i] = (uint8_t)(2 + i / (t + 2));
+        }
+    }
+
+    size_t spread = source->mean_bytes * 3 / 10;
+    size_t scan_len = source->mean_bytes - spread / 2 + (spread ? next_random(source) % spread : 0);
+    if (SYNTHETIC_HEADER_MAX + scan_len > capacity) {
+        return -1;
+    }
+
+    uint8_t *out = (uint8_t *)data;
+    out[0] = 0xFF;
+    out[1] = 0xD8;  // SOI
+    size_t pos = 2;
+    pos = put_marker(data, pos, 0xE0, jfif, sizeof(jfif));
+    pos = put_marker(data, pos, 0xDB, dqt, sizeof(dqt));
+    pos = put_marker(data, pos, 0xC0, sof, sizeof(sof));
+    pos = put_marker(data, pos, 0xDA, sos, sizeof(sos));
+
+    // 填充的 0x00 计入扫描数据长度，末尾留两个字节给 EOI
+    size_t end = pos + scan_len;
+    while (pos + 8 <= end) {
+        uint64_t word = next_random(source);
+        uint64_t inverted = ~word;
+        if (((inverted - 0x0101010101010101ULL) & ~inverted & 0x8080808080808080ULL) == 0) {
+            memcpy(out + pos, &word, 8);
+            pos += 8;
+            continue;
+        }
+        for (int i = 0; i < 8 && pos + 2 <= end; i++) {
+            uint8_t byte = (uint8_t)(word >> (i * 8));
+            out[pos++] = byte;
+            if (byte == 0xFF) {
+                out[pos++] = 0x00;
+            }
+        }
+    }
+    while (pos < end) {
+        out[pos++] = 0x5A;
+    }
+    out[pos++] = 0xFF;
+    out[pos++] = 0xD9;  // EOI
+    return (long)pos;
+}
+
+CameraSource *camera_source_create(const char *name, size_t frame_bytes) {
+    CameraSource *source = calloc(1, sizeof(CameraSource));
+    if (!source) {
+        return NULL;
+    }
+    if (strcmp(name, "test") == 0) {
+        source->name = "test";
+        source->max_bytes = strlen(TEST_IMAGE_DATA);
+        source->capture = capture_test;
+    } else if (strcmp(name, "synthetic") == 0) {
+        source->name = "synthetic";
+        source->mean_bytes = frame_bytes > 0 ? frame_bytes : SYNTHETIC_DEFAULT_BYTES;
+        source->max_bytes = SYNTHETIC_HEADER_MAX + source->mean_bytes + source->mean_bytes * 3 / 10;
+        source->capture = capture_synthetic;
+        source->rng = 0x9E3779B97F4A7C15ULL ^ (uint64_t)time(NULL);
+    } else {
+        free(source);
+        return NULL;
+    }
+    return source;
+}
+
+void camera_source_destroy(CameraSource *source) {
+    free(source);
+}
+
+const char *camera_source_name(const CameraSource *source) {
+    return source->name;
+}
+
+size_t camera_source_max_bytes(const CameraSource *source) {
+    return source->max_bytes;
+}
+
+long camera_source_capture(CameraSource *source, char *data, size_t capacity) {
+    return source->capture(source, data, capacity);
+}
+
+int camera_open(Camera *camera, CameraSource *source) {
+    memset(camera, 0, sizeof(*camera));
+    for (int i = 0; i < CAMERA_POOL_FRAMES; i++) {
+        camera->frames[i].data = malloc(camera_source_max_bytes(source));
+        if (!camera->frames[i].data) {
+            for (int j = 0; j < i; j++) {
+                free(camera->frames[j].data);
+            }
+            return -1;
+        }
+        camera->frames[i].next = camera->free_list;
+        camera->free_list = &camera->frames[i];
+    }
+    camera->source = source;
+    pthread_mutex_init(&camera->lock, NULL);
+    pthread_cond_init(&camera->available, NULL);
+    pthread_mutex_init(&camera->capture_lock, NULL);
+    return 0;
+}
+
+void camera_close(Camera *camera) {
+    for (int i = 0; i < CAMERA_POOL_FRAMES; i++) {
+        free(camera->frames[i].data);
+    }
+    camera_source_destroy(camera->source);
+    pthread_mutex_destroy(&camera->lock);
+    pthread_cond_destroy(&camera->available);
+    pthread_mutex_destroy(&camera->capture_lock);
+    memset(camera, 0, sizeof(*camera));
+}
+
+CameraFrame *camera_capture(Camera *camera) {
+    pthread_mutex_lock(&camera->lock);
+    while (!camera->free_list) {
+        pthread_cond_wait(&camera->available, &camera->lock);
+    }
+    CameraFrame *frame = camera->free_list;
+    camera->free_list = frame->next;
+    pthread_mutex_unlock(&camera->lock);
+
+    pthread_mutex_lock(&camera->capture_lock);
+    long len = camera_source_capture(camera->source, frame->data, camera_source_max_bytes(camera->source));
+    struct timespec now;
+    clock_gettime(CLOCK_REALTIME, &now);
+    pthread_mutex_unlock(&camera->capture_lock);
+
+    pthread_mutex_lock(&camera->lock);
+    if (len < 0) {
+        camera->failed++;
+        pthread_mutex_unlock(&camera->lock);
+        camera_release(camera, frame);
+        return NULL;
+    }
+    frame->length = (size_t)len;
+    frame->sequence = ++camera->sequence;
+    frame->timestamp = now.tv_sec * 1000000000LL + now.tv_nsec;
+    camera->captured++;
+    pthread_mutex_unlock(&camera->lock);
+    return frame;
+}
+
+void camera_release(Camera *camera, CameraFrame *frame) {
+    pthread_mutex_lock(&camera->lock);
+    frame->next = camera->free_list;
+    camera->free_list = frame;
+    pthread_cond_signal(&camera->available);
+    pthread_mutex_unlock(&camera->lock);
+}
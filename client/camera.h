@@ -0,0 +1,56 @@
+#ifndef CAMERA_H
+#define CAMERA_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <pthread.h>
+
+// 图像源：把一帧JPEG图像直接拍摄到调用方的内存中，不经过临时文件。
+// "test" 为原来的模拟拍摄，每帧是同样的一小段测试数据；
+// "synthetic" 生成大小和结构接近真实JPEG的帧（SOI、JFIF、量化表、帧头、扫描数据、EOI），
+// 每帧内容不同，大小在平均值上下浮动，用于基准测试和推流压测。
+// 接入真实摄像头时在 camera.c 中增加一种图像源即可，发送路径不变。
+typedef struct CameraSource CameraSource;
+
+// 按名称创建图像源，frame_bytes 为 synthetic 的平均帧大小，0 使用默认值；未知名称返回 NULL
+CameraSource *camera_source_create(const char *name, size_t frame_bytes);
+void camera_source_destroy(CameraSource *source);
+const char *camera_source_name(const CameraSource *source);
+// 一帧的最大长度
+size_t camera_source_max_bytes(const CameraSource *source);
+// 拍摄一帧写入 data，返回长度，失败返回-1
+long camera_source_capture(CameraSource *source, char *data, size_t capacity);
+
+// 帧池中的一帧，缓冲区按图像源的最大帧长预先分配，反复使用
+typedef struct CameraFrame {
+    struct CameraFrame *next;  // 空闲链表
+    char *data;
+    size_t length;
+    uint64_t sequence;   // 拍摄序号，从1开始
+    int64_t timestamp;   // 拍摄时间，纳秒，CLOCK_REALTIME
+} CameraFrame;
+
+// 每个使用者最多同时持有两帧（双缓冲）：推流线程拍摄下一帧时上一帧仍然有效，
+// 用于比较画面是否变化；服务器消息处理线程处理 get_jpeg 时另取一帧
+#define CAMERA_POOL_FRAMES 4
+
+typedef struct {
+    CameraSource *source;
+    pthread_mutex_t lock;          // 保护空闲链表和统计
+    pthread_cond_t available;      // 有帧归还
+    pthread_mutex_t capture_lock;  // 摄像头一次只拍一帧
+    CameraFrame frames[CAMERA_POOL_FRAMES];
+    CameraFrame *free_list;
+    uint64_t sequence;
+    long long captured;
+    long long failed;
+} Camera;
+
+// 打开摄像头，source 归 camera 所有，失败返回-1
+int camera_open(Camera *camera, CameraSource *source);
+void camera_close(Camera *camera);
+// 从帧池取一帧并拍摄，帧池用完时等待其他使用者归还；失败返回 NULL
+CameraFrame *camera_capture(Camera *camera);
+void camera_release(Camera *camera, CameraFrame *frame);
+
+#endif
@@ -0,0 +1,192 @@
+// 拍摄发送基准：对比原来经过临时文件的 get_jpeg 路径（拍摄写入 capture_xxx.jpg、重新打开、
+// sendfile 发送、删除）和帧池路径（拍摄到池中的内存帧，图像头和数据一次写出）的每帧耗时和吞吐。
+// 通过 make bench 编译运行。
+//
+// 用法：./capture_bench [-n 帧数] [-k 平均帧KB] [-c test|synthetic]
+// 数据写入本地套接字对，由另一个线程读走丢弃，不受网络影响；"capture only" 为图像源本身生成帧的耗时。
+// 临时文件在运行目录下，结果受文件系统和页缓存影响。
+
+#ifdef __linux__
+#define _GNU_SOURCE  // MSG_MORE
+#endif
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <time.h>
+#include <pthread.h>
+#include <sys/stat.h>
+#ifdef __linux__
+#include <sys/sendfile.h>
+#endif
+#include "camera.h"
+#include "frame.h"
+
+static double now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+// 读走并丢弃发送的数据
+static void *drain_thread(void *arg) {
+    int sock = *(int *)arg;
+    char buffer[256 * 1024];
+    while (read(sock, buffer, sizeof(buffer)) > 0) {
+    }
+    return NULL;
+}
+
+// 原来的路径：拍摄写入临时文件，打开文件取大小，图像头带 MSG_MORE 发送后 sendfile，最后删除文件
+static int send_via_file(int sock, CameraSource *source, char *scratch, size_t capacity, size_t *bytes) {
+    char filename[64];
+    snprintf(filename, sizeof(filename), "capture_%ld.jpg", (long)getpid());
+    long len = camera_source_capture(source, scratch, capacity);
+    FILE *fp = fopen(filename, "w");
+    if (len < 0 || !fp) {
+        if (fp) {
+            fclose(fp);
+        }
+        return -1;
+    }
+    fwrite(scratch, 1, (size_t)len, fp);
+    fclose(fp);
+
+    int fd = open(filename, O_RDONLY);
+    struct stat file_stat;
+    if (fd < 0 || fstat(fd, &file_stat) < 0) {
+        return -1;
+    }
+    uint8_t header[FRAME_HEADER_SIZE];
+    frame_header_encode(header, FRAME_BINARY, (uint32_t)file_stat.st_size);
+#ifdef __linux__
+    struct iovec iov = { header, sizeof(header) };
+    int ret = frame_sendv(sock, &iov, 1, MSG_MORE);
+    off_t offset = 0;
+    while (ret == 0 && offset < file_stat.st_size) {
+        ssize_t n = sendfile(sock, fd, &offset, file_stat.st_size - offset);
+        if (n <= 0 && !(n < 0 && errno == EINTR)) {
+            ret = -1;
+        }
+    }
+#else
+    ssize_t n = pread(fd, scratch, (size_t)file_stat.st_size, 0);
+    struct iovec iov[2] = { { header, sizeof(header) }, { scratch, n > 0 ? (size_t)n : 0 } };
+    int ret = n == file_stat.st_size ? frame_sendv(sock, iov, 2, 0) : -1;
+#endif
+    close(fd);
+    remove(filename);
+    *bytes += (size_t)file_stat.st_size;
+    return ret;
+}
+
+// 帧池路径：拍摄到池中的帧，图像头和图像数据一次写出，归还帧
+static int send_via_pool(int sock, Camera *camera, size_t *bytes) {
+    CameraFrame *frame = camera_capture(camera);
+    if (!frame) {
+        return -1;
+    }
+    uint8_t header[FRAME_HEADER_SIZE];
+    frame_header_encode(header, FRAME_BINARY, (uint32_t)frame->length);
+    struct iovec iov[2] = { { header, sizeof(header) }, { frame->data, frame->length } };
+    int ret = frame_sendv(sock, iov, 2, 0);
+    *bytes += frame->length;
+    camera_release(camera, frame);
+    return ret;
+}
+
+static void print_result(const char *name, double elapsed, int frames, size_t bytes) {
+    printf("%-16s %12.1f %12.0f %10.1f\n", name, elapsed / frames / 1e3, frames / elapsed * 1e9,
+           bytes / elapsed * 1e3);
+}
+
+int main(int argc, char *argv[]) {
+    int frames = 2000;
+    int kb = 96;
+    const char *source_name = "synthetic";
+
+    int opt;
+    while ((opt = getopt(argc, argv, "n:k:c:")) != -1) {
+        switch (opt) {
+            case 'n':
+                frames = atoi(optarg);
+                break;
+            case 'k':
+                kb = atoi(optarg);
+                break;
+            case 'c':
+                source_name = optarg;
+                break;
+            default:
+                fprintf(stderr, "用法: %s [-n 帧数] [-k 平均帧KB] [-c test|synthetic]\n", argv[0]);
+                return 1;
+        }
+    }
+    if (frames <= 0 || kb <= 0) {
+        fprintf(stderr, "参数无效\n");
+        return 1;
+    }
+
+    CameraSource *file_source = camera_source_create(source_name, (size_t)kb * 1024);
+    CameraSource *pool_source = camera_source_create(source_name, (size_t)kb * 1024);
+    Camera camera;
+    if (!file_source || !pool_source || camera_open(&camera, pool_source) < 0) {
+        fprintf(stderr, "无法打开图像源: %s\n", source_name);
+        return 1;
+    }
+    size_t capacity = camera_source_max_bytes(file_source);
+    char *scratch = malloc(capacity);
+
+    int socks[2];
+    if (!scratch || socketpair(AF_UNIX, SOCK_STREAM, 0, socks) < 0) {
+        perror("socketpair");
+        return 1;
+    }
+    pthread_t drain;
+    pthread_create(&drain, NULL, drain_thread, &socks[1]);
+
+    printf("%d 帧，图像源 %s，平均 %d KB\n\n", frames, source_name, kb);
+    printf("%-16s %12s %12s %10s\n", "path", "us/frame", "frames/s", "MB/s");
+
+    size_t bytes = 0;
+    double start = now_ns();
+    for (int i = 0; i < frames; i++) {
+        CameraFrame *frame = camera_capture(&camera);
+        if (frame) {
+            bytes += frame->length;
+            camera_release(&camera, frame);
+        }
+    }
+    print_result("capture only", now_ns() - start, frames, bytes);
+
+    bytes = 0;
+    start = now_ns();
+    for (int i = 0; i < frames; i++) {
+        if (send_via_file(socks[0], file_source, scratch, capacity, &bytes) < 0) {
+            perror("temp file");
+            return 1;
+        }
+    }
+    print_result("temp file", now_ns() - start, frames, bytes);
+
+    bytes = 0;
+    start = now_ns();
+    for (int i = 0; i < frames; i++) {
+        if (send_via_pool(socks[0], &camera, &bytes) < 0) {
+            perror("camera pool");
+            return 1;
+        }
+    }
+    print_result("camera pool", now_ns() - start, frames, bytes);
+
+    shutdown(socks[0], SHUT_WR);
+    pthread_join(drain, NULL);
+    close(socks[0]);
+    close(socks[1]);
+    camera_close(&camera);
+    camera_source_destroy(file_source);
+    free(scratch);
+    return 0;
+}
@@ -1,3 +1,6 @@
+#ifdef __linux__
+#define _GNU_SOURCE  // MSG_ZEROCOPY
+#endif
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -9,9 +12,15 @@
 #include <signal.h>
 #include <errno.h>
 #include <time.h>   // 添加时间头文件
-#include <sys/stat.h>  // 添加文件状态头文件
-#include <fcntl.h>  // 添加文件控制头文件
+#include <stdint.h>
+#ifdef __linux__
+#include <poll.h>
+#include <linux/errqueue.h>
+#endif
 #include "cJSON.h"
+#include "frame.h"
+#include "wire.h"
+#include "camera.h"
 
 #define SERVER_IP "127.0.0.1"
 #define PORT 5566
@@ -24,11 +33,46 @@
 
 #define BROADCAST_PORT 5567
 #define DISCOVERY_TIMEOUT 30  // 30秒超时
+#define JPEG_HEADER_MAX 256  // 图像头（JSON帧+二进制帧头）的最大长度
+#define ZEROCOPY_MIN_SIZE (64 * 1024)  // 小于该大小的图像直接拷贝更快
+#define STREAM_FPS_MAX 1000  // 推流帧率上限
+#define STREAM_CHANGE_POLL_MS 100  // 只在画面变化时推送且没有指定帧率时，检查画面的间隔
+#define CAMERA_SOURCE "test"  // 默认图像源，可用 -c 指定
 
 // 全局变量，用于控制连接状态
 volatile int connected = 0;
 int server_sock = -1;
 
+// MSG_ZEROCOPY 状态：每次零拷贝发送占用一个通知编号
+int zerocopy_enabled = 0;
+uint32_t zerocopy_next_id = 0;
+
+// 服务器已在 upload_url 回复中同意紧凑编码，之后发送 FRAME_COMPACT 帧
+int compact_enabled = 0;
+
+// 图像源和帧池，get_jpeg 和推流都从这里取帧，拍摄到内存中直接发送
+Camera camera;
+
+// 服务器消息处理线程和推流线程都会发送，每条消息（图像连同图像头）在锁内完整写出
+pthread_mutex_t send_lock = PTHREAD_MUTEX_INITIALIZER;
+
+// 推流状态：subscribe 命令设置帧率和流控窗口，credit 命令增加额度，推流线程按帧率发送
+typedef struct {
+    pthread_mutex_t lock;
+    pthread_cond_t changed;  // 订阅或流控额度变化
+    int running;             // 推流线程正在运行
+    int fps;
+    int on_change;           // 只在画面变化时发送
+    int credits;             // 还可以发送的帧数
+    long long frames;        // 本次推流已发送的帧数
+    long long bytes;
+    long long unchanged;     // 画面未变化而没有发送的帧数
+    long long stalls;        // 流控额度用完而等待的次数
+    struct timespec start;
+} FrameStream;
+
+FrameStream stream = { PTHREAD_MUTEX_INITIALIZER, PTHREAD_COND_INITIALIZER, 0, 0, 0, 0, 0, 0, 0, 0, { 0, 0 } };
+
 // 信号处理函数，用于优雅地关闭连接
 void signal_handler(int sig) {
     if (server_sock >= 0) {
@@ -38,36 +82,138 @@ void signal_handler(int sig) {
     exit(0);
 }
 
+// 为新连接开启 MSG_ZEROCOPY，内核不支持时退回普通发送
+void zerocopy_init(int sock) {
+    zerocopy_enabled = 0;
+    zerocopy_next_id = 0;
+#if defined(__linux__) && defined(SO_ZEROCOPY)
+    int one = 1;
+    if (setsockopt(sock, SOL_SOCKET, SO_ZEROCOPY, &one, sizeof(one)) == 0) {
+        zerocopy_enabled = 1;
+    }
+#else
+    (void)sock;
+#endif
+}
+
+#if defined(__linux__) && defined(SO_ZEROCOPY)
+// 等待内核释放所有零拷贝发送的缓冲区，之后调用方才能复用内存
+static int zerocopy_wait(int sock) {
+    uint32_t completed = 0;
+    
+    while (completed < zerocopy_next_id) {
+        struct pollfd pfd = { sock, 0, 0 };
+        if (poll(&pfd, 1, 1000) <= 0) {
+            return -1;
+        }
+        
+        char control[128];
+        struct msghdr msg;
+        memset(&msg, 0, sizeof(msg));
+        msg.msg_control = control;
+        msg.msg_controllen = sizeof(control);
+        if (recvmsg(sock, &msg, MSG_ERRQUEUE) < 0) {
+            if (errno == EAGAIN || errno == EINTR) {
+                continue;
+            }
+            return -1;
+        }
+        
+        for (struct cmsghdr *cm = CMSG_FIRSTHDR(&msg); cm; cm = CMSG_NXTHDR(&msg, cm)) {
+            struct sock_extended_err *err = (struct sock_extended_err *)CMSG_DATA(cm);
+            if (err->ee_errno == 0 && err->ee_origin == SO_EE_ORIGIN_ZEROCOPY) {
+                // ee_info..ee_data 范围内的发送已完成
+                if (err->ee_data + 1 > completed) {
+                    completed = err->ee_data + 1;
+                }
+            }
+        }
+    }
+    return 0;
+}
+
+// 零拷贝发送 iov 中的全部数据
+static int zerocopy_sendv(int sock, struct iovec *iov, int iovcnt) {
+    struct msghdr msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = iov;
+    msg.msg_iovlen = iovcnt;
+    
+    while (msg.msg_iovlen > 0) {
+        ssize_t n = sendmsg(sock, &msg, MSG_ZEROCOPY | MSG_NOSIGNAL);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return -1;
+        }
+        zerocopy_next_id++;
+        
+        while (msg.msg_iovlen > 0 && (size_t)n >= msg.msg_iov[0].iov_len) {
+            n -= msg.msg_iov[0].iov_len;
+            msg.msg_iov++;
+            msg.msg_iovlen--;
+        }
+        if (msg.msg_iovlen > 0) {
+            msg.msg_iov[0].iov_base = (char *)msg.msg_iov[0].iov_base + n;
+            msg.msg_iov[0].iov_len -= n;
+        }
+    }
+    return zerocopy_wait(sock);
+}
+#endif
+
+// 发送一条 JSON 编码的消息
+static int send_json(int sock, const WireMessage *msg) {
+    char buffer[WIRE_JSON_MAX];
+    int len = wire_encode_json(msg, buffer, sizeof(buffer));
+    if (len < 0) {
+        return -1;
+    }
+    pthread_mutex_lock(&send_lock);
+    int ret = frame_send(sock, FRAME_JSON, buffer, len);
+    pthread_mutex_unlock(&send_lock);
+    return ret;
+}
+
 // 发送初始消息
 void send_initial_message(int sock) {
-    cJSON *root = cJSON_CreateObject();
-    cJSON_AddStringToObject(root, "reason", "init_slam");
+    // 申请紧凑编码，不支持的服务器会忽略 encodings 字段
+    WireMessage msg = { .type = WIRE_INIT, .init = { .compact = 1 } };
+    strcpy(msg.init.reason, "init_slam");
     
     // 如果有预设的RTSP URL，则添加到初始消息中
     // 如果没有，服务器可能会在后续命令中提供URL
     #ifdef HAS_RTSP_URL
-    cJSON_AddStringToObject(root, "rtsp_url", RTSP_URL);
+    snprintf(msg.init.url, sizeof(msg.init.url), "%s", RTSP_URL);
     #endif
     
-    char *json_str = cJSON_PrintUnformatted(root);
-    send(sock, json_str, strlen(json_str), 0);
-    
-    free(json_str);
-    cJSON_Delete(root);
+    send_json(sock, &msg);
+}
+
+// 发送一条紧凑编码的消息
+static int send_compact(int sock, const WireMessage *msg) {
+    uint8_t buffer[WIRE_MESSAGE_MAX];
+    int len = wire_encode(msg, buffer, sizeof(buffer));
+    if (len < 0) {
+        return -1;
+    }
+    pthread_mutex_lock(&send_lock);
+    int ret = frame_send(sock, FRAME_COMPACT, buffer, len);
+    pthread_mutex_unlock(&send_lock);
+    return ret;
 }
 
 void send_status_response(int sock) {
-    cJSON *root = cJSON_CreateObject();
-    cJSON_AddStringToObject(root, "status", "ok");
-    cJSON_AddNumberToObject(root, "battery", 85); // 假设电池电量为85%
-    cJSON_AddBoolToObject(root, "is_moving", 0); // 假设当前未在移动
-    cJSON_AddStringToObject(root, "current_position", "home");
-    
-    char *json_str = cJSON_PrintUnformatted(root);
-    send(sock, json_str, strlen(json_str), 0);
-    
-    free(json_str);
-    cJSON_Delete(root);
+    // 假设电池电量为85%，当前未在移动
+    WireMessage msg = { .type = WIRE_STATUS, .status = { .battery = 85, .is_moving = 0 } };
+    strcpy(msg.status.status, "ok");
+    strcpy(msg.status.position, "home");
+    if (compact_enabled) {
+        send_compact(sock, &msg);
+    } else {
+        send_json(sock, &msg);
+    }
 }
 
 int robot_move(const char *direction, int duration) {
@@ -138,28 +284,32 @@ int discover_server(char *server_ip, int *server_port) {
     buffer[bytes_received] = '\0';
     printf("收到服务器广播: %s\n", buffer);
     
-    // 解析JSON消息
-    cJSON *root = cJSON_Parse(buffer);
-    if (!root) {
+    // 解析JSON消息，整棵树放在一个文档里，用完一次释放；连接线程只发现一次，不保留缓存的内存块
+    cJSON_Document *document = cJSON_ParseDocument(buffer, (size_t)bytes_received);
+    if (!document) {
         printf("解析广播消息失败\n");
+        cJSON_FreeDocumentCache();
         close(broadcast_sock);
         return -1;
     }
     
-    cJSON *ip = cJSON_GetObjectItem(root, "server_ip");
-    cJSON *port = cJSON_GetObjectItem(root, "server_port");
+    cJSON *root = cJSON_DocumentRoot(document);
+    cJSON *ip = cJSON_GetObjectItemCaseSensitive(root, "server_ip");
+    cJSON *port = cJSON_GetObjectItemCaseSensitive(root, "server_port");
     
-    if (!ip || !port) {
+    if (!cJSON_IsString(ip) || !cJSON_IsNumber(port)) {
         printf("广播消息格式错误\n");
-        cJSON_Delete(root);
+        cJSON_DeleteDocument(document);
+        cJSON_FreeDocumentCache();
         close(broadcast_sock);
         return -1;
     }
     
-    strcpy(server_ip, ip->valuestring);
+    snprintf(server_ip, INET_ADDRSTRLEN, "%s", ip->valuestring);
     *server_port = port->valueint;
     
-    cJSON_Delete(root);
+    cJSON_DeleteDocument(document);
+    cJSON_FreeDocumentCache();
     close(broadcast_sock);
     
     printf("发现服务器: IP=%s, 端口=%d\n", server_ip, *server_port);
@@ -195,6 +345,8 @@ int connect_to_server(const char *server_ip, int server_port) {
     }
     
     printf("已连接到服务器 %s:%d\n", server_ip, server_port);
+    zerocopy_init(sock);
+    compact_enabled = 0;
     
     // 发送初始消息
     send_initial_message(sock);
@@ -202,164 +354,360 @@ int connect_to_server(const char *server_ip, int server_port) {
     return sock;
 }
 
-// 模拟拍摄照片，实际应用中可能调用摄像头API
-int capture_jpeg(const char *filename) {
-    // 模拟拍照，仅用于演示
-    // 实际应用中，这里应该调用相机API拍照
-    printf("模拟拍摄照片: %s\n", filename);
-    
-    // 创建一个简单的测试图像文件（如果实际系统中没有摄像头）
-    FILE *fp = fopen(filename, "w");
-    if (!fp) {
-        perror("无法创建图像文件");
+// 生成图像头：JSON（或紧凑编码）头信息帧加上图像数据的二进制帧头，返回长度，失败返回-1。
+// 推流的帧带 stream 标记，服务器据此把它与 get_jpeg 的回复区分开，计入推流并归还额度
+int build_jpeg_header(char *out, size_t out_size, size_t image_size, int streamed) {
+    WireMessage msg = { .type = WIRE_JPEG_IMAGE,
+                        .jpeg_image = { .timestamp = time(NULL), .size = (int64_t)image_size, .stream = streamed } };
+    if (out_size < 2 * FRAME_HEADER_SIZE) {
         return -1;
     }
     
-    // 写入一些假数据，表示JPEG文件内容
-    const char *test_data = "JPEG TEST IMAGE DATA";
-    fwrite(test_data, strlen(test_data), 1, fp);
-    fclose(fp);
+    char *payload = out + FRAME_HEADER_SIZE;
+    size_t payload_size = out_size - 2 * FRAME_HEADER_SIZE;
+    int len = compact_enabled ? wire_encode(&msg, (uint8_t *)payload, payload_size)
+                              : wire_encode_json(&msg, payload, payload_size);
+    if (len < 0) {
+        return -1;
+    }
     
-    return 0;
+    frame_header_encode((uint8_t *)out, compact_enabled ? FRAME_COMPACT : FRAME_JSON, (uint32_t)len);
+    frame_header_encode((uint8_t *)payload + len, FRAME_BINARY, (uint32_t)image_size);
+    return len + 2 * FRAME_HEADER_SIZE;
+}
+
+static double elapsed_ms(const struct timespec *start) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (now.tv_sec - start->tv_sec) * 1e3 + (now.tv_nsec - start->tv_nsec) / 1e6;
 }
 
-// 发送JPEG图像给服务器
-int send_jpeg_image(int sock, const char *filename) {
-    // 打开文件
-    FILE *fp = fopen(filename, "rb");
-    if (!fp) {
-        perror("无法打开图像文件");
+// 写出内存中的JPEG图像，图像头和图像数据合并为一次写入
+static int write_jpeg_buffer(int sock, const void *data, size_t size, int streamed) {
+    char header[JPEG_HEADER_MAX];
+    int header_len = build_jpeg_header(header, sizeof(header), size, streamed);
+    if (header_len < 0) {
+        printf("生成图像头信息失败\n");
         return -1;
     }
     
-    // 获取文件大小
-    struct stat file_stat;
-    if (stat(filename, &file_stat) < 0) {
-        perror("无法获取文件状态");
-        fclose(fp);
+    struct iovec iov[2];
+    iov[0].iov_base = header;
+    iov[0].iov_len = header_len;
+    iov[1].iov_base = (void *)data;
+    iov[1].iov_len = size;
+    
+    int ret;
+    pthread_mutex_lock(&send_lock);
+#if defined(__linux__) && defined(SO_ZEROCOPY)
+    if (zerocopy_enabled && size >= ZEROCOPY_MIN_SIZE) {
+        ret = zerocopy_sendv(sock, iov, 2);
+    } else {
+        ret = frame_sendv(sock, iov, 2, 0);
+    }
+#else
+    ret = frame_sendv(sock, iov, 2, 0);
+#endif
+    pthread_mutex_unlock(&send_lock);
+    if (ret < 0) {
+        perror("发送图像数据失败");
         return -1;
     }
+    return 0;
+}
+
+// 发送内存中的JPEG图像
+int send_jpeg_buffer(int sock, const void *data, size_t size) {
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
     
-    // 准备要发送的JSON头信息
-    cJSON *header = cJSON_CreateObject();
-    cJSON_AddStringToObject(header, "response", "jpeg_image");
-    cJSON_AddNumberToObject(header, "timestamp", (double)time(NULL));
-    cJSON_AddNumberToObject(header, "size", (double)file_stat.st_size);
-    
-    char *header_str = cJSON_PrintUnformatted(header);
-    
-    // 发送头信息
-    if (send(sock, header_str, strlen(header_str), 0) < 0) {
-        perror("发送图像头信息失败");
-        free(header_str);
-        cJSON_Delete(header);
-        fclose(fp);
+    if (write_jpeg_buffer(sock, data, size, 0) < 0) {
         return -1;
     }
     
-    // 给服务器一点时间处理头信息
-    usleep(100000);  // 100ms
-    
-    // 读取并发送文件内容
-    char buffer[4096];
-    size_t bytes_read;
-    size_t total_sent = 0;
-    
-    while ((bytes_read = fread(buffer, 1, sizeof(buffer), fp)) > 0) {
-        if (send(sock, buffer, bytes_read, 0) < 0) {
-            perror("发送图像数据失败");
-            free(header_str);
-            cJSON_Delete(header);
-            fclose(fp);
-            return -1;
+    printf("已发送图像 (%zu 字节, %.2f ms)\n", size, elapsed_ms(&start));
+    return 0;
+}
+
+static long long timespec_ns(const struct timespec *ts) {
+    return ts->tv_sec * 1000000000LL + ts->tv_nsec;
+}
+
+// 打印本次推流的帧数和持续帧率，调用方持有 stream.lock
+static void show_stream_stats(const char *title) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    double seconds = (timespec_ns(&now) - timespec_ns(&stream.start)) / 1e9;
+    printf("%s: 已发送 %lld 帧, %.1f MB, %.1f fps, %.1f MB/s, 画面未变化 %lld 帧, 等待流控 %lld 次\n",
+           title, stream.frames, stream.bytes / 1e6,
+           seconds > 0 ? stream.frames / seconds : 0.0, seconds > 0 ? stream.bytes / seconds / 1e6 : 0.0,
+           stream.unchanged, stream.stalls);
+}
+
+// 推流线程：按帧率拍摄发送，发送一帧用掉一个流控额度，额度用完时等待服务器的 credit 命令。
+// 不等待服务器回复，帧之间没有命令往返
+void *stream_thread(void *arg) {
+    (void)arg;
+    CameraFrame *last = NULL;  // 上一帧，拍摄下一帧时仍然保留，按变化发送时与新的一帧比较
+    struct timespec next;
+    clock_gettime(CLOCK_MONOTONIC, &next);
+    
+    pthread_mutex_lock(&stream.lock);
+    while (connected && (stream.fps > 0 || stream.on_change)) {
+        if (stream.credits <= 0) {
+            stream.stalls++;
+            while (connected && stream.credits <= 0 && (stream.fps > 0 || stream.on_change)) {
+                pthread_cond_wait(&stream.changed, &stream.lock);
+            }
+            continue;
+        }
+        
+        // 等到下一帧的时间；期间订阅变化时重新检查
+        struct timespec now;
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        long long wait_ns = timespec_ns(&next) - timespec_ns(&now);
+        if (wait_ns > 0) {
+            struct timespec deadline;
+            clock_gettime(CLOCK_REALTIME, &deadline);
+            long long deadline_ns = timespec_ns(&deadline) + wait_ns;
+            deadline.tv_sec = deadline_ns / 1000000000LL;
+            deadline.tv_nsec = deadline_ns % 1000000000LL;
+            pthread_cond_timedwait(&stream.changed, &stream.lock, &deadline);
+            continue;
+        }
+        long long interval = stream.fps > 0 ? 1000000000LL / stream.fps : STREAM_CHANGE_POLL_MS * 1000000LL;
+        long long next_ns = timespec_ns(&next) + interval;
+        if (next_ns < timespec_ns(&now)) {
+            // 拍摄或发送跟不上帧率时不补发
+            next_ns = timespec_ns(&now);
+        }
+        next.tv_sec = next_ns / 1000000000LL;
+        next.tv_nsec = next_ns % 1000000000LL;
+        int on_change = stream.on_change;
+        pthread_mutex_unlock(&stream.lock);
+        
+        CameraFrame *frame = camera_capture(&camera);
+        int sent = 0;
+        int unchanged = 0;
+        size_t size = 0;
+        if (frame) {
+            size = frame->length;
+            unchanged = on_change && last && last->length == frame->length &&
+                        memcmp(last->data, frame->data, frame->length) == 0;
+            if (!unchanged) {
+                sent = write_jpeg_buffer(server_sock, frame->data, frame->length, 1) == 0;
+            }
+            if (last) {
+                camera_release(&camera, last);
+            }
+            last = frame;
+        }
+        
+        pthread_mutex_lock(&stream.lock);
+        if (sent) {
+            stream.credits--;
+            stream.frames++;
+            stream.bytes += size;
+        } else if (unchanged) {
+            stream.unchanged++;
+        } else {
+            printf("推流失败，停止推流\n");
+            stream.fps = 0;
+            stream.on_change = 0;
         }
-        total_sent += bytes_read;
     }
+    show_stream_stats("推流结束");
+    stream.running = 0;
+    pthread_cond_broadcast(&stream.changed);
+    pthread_mutex_unlock(&stream.lock);
     
-    printf("已发送图像 %s (%zu 字节)\n", filename, total_sent);
-    
-    free(header_str);
-    cJSON_Delete(header);
-    fclose(fp);
+    if (last) {
+        camera_release(&camera, last);
+    }
+    return NULL;
+}
+
+// 处理 subscribe 命令：更新帧率和流控窗口，需要时启动推流线程
+static void stream_subscribe(const WireSubscribe *sub) {
+    pthread_mutex_lock(&stream.lock);
+    stream.fps = sub->fps < 0 ? 0 : sub->fps > STREAM_FPS_MAX ? STREAM_FPS_MAX : (int)sub->fps;
+    stream.on_change = sub->on_change;
+    stream.credits = sub->credits > 0 ? (int)sub->credits : 0;
+    
+    if (stream.fps > 0 || stream.on_change) {
+        printf("开始推流: %d fps%s, 流控窗口 %d 帧\n", stream.fps, stream.on_change ? "，画面变化时发送" : "",
+               stream.credits);
+        if (!stream.running) {
+            stream.frames = stream.bytes = stream.unchanged = stream.stalls = 0;
+            clock_gettime(CLOCK_MONOTONIC, &stream.start);
+            pthread_t thread;
+            if (pthread_create(&thread, NULL, stream_thread, NULL) == 0) {
+                pthread_detach(thread);
+                stream.running = 1;
+            } else {
+                perror("创建推流线程失败");
+            }
+        }
+    } else {
+        printf("停止推流\n");
+    }
+    pthread_cond_broadcast(&stream.changed);
+    pthread_mutex_unlock(&stream.lock);
+}
+
+// 处理 credit 命令：服务器收完了一些帧，增加发送额度
+static void stream_credit(int64_t frames) {
+    pthread_mutex_lock(&stream.lock);
+    if (frames > 0) {
+        stream.credits += (int)frames;
+        pthread_cond_broadcast(&stream.changed);
+    }
+    pthread_mutex_unlock(&stream.lock);
+}
+
+// 连接断开时停止推流，等推流线程退出后才能建立新连接
+static void stream_stop(void) {
+    pthread_mutex_lock(&stream.lock);
+    stream.fps = 0;
+    stream.on_change = 0;
+    pthread_cond_broadcast(&stream.changed);
+    while (stream.running) {
+        pthread_cond_wait(&stream.changed, &stream.lock);
+    }
+    pthread_mutex_unlock(&stream.lock);
+}
+
+// 执行一条服务器命令，JSON 和紧凑编码的命令都转换为 WireMessage
+void run_command(int sock, const WireMessage *msg) {
+    // 每种命令都带时间戳
+    int64_t timestamp = msg->type == WIRE_MOVE ? msg->move.timestamp
+                      : msg->type == WIRE_GET_JPEG ? msg->get_jpeg.timestamp
+                      : msg->type == WIRE_SUBSCRIBE ? msg->subscribe.timestamp : msg->check_status.timestamp;
+    printf("收到命令: %s 时间戳: %lld\n", wire_command_name(msg->type), (long long)timestamp);
+    
+    // 处理不同类型的命令
+    if (msg->type == WIRE_CHECK_STATUS) {
+        // 发送状态回复
+        send_status_response(sock);
+    } else if (msg->type == WIRE_MOVE) {
+        // 处理移动命令
+        int has_direction = WIRE_HAS(msg, WIRE_FIELD_DIRECTION);
+        int has_duration = WIRE_HAS(msg, WIRE_FIELD_DURATION);
+        
+        if (has_direction && has_duration) {
+            printf("移动方向: %s 持续时间: %lld秒\n", 
+                   msg->move.direction, (long long)msg->move.duration);
+            robot_move(msg->move.direction, (int)msg->move.duration);  
+        } else if (has_direction && !has_duration) {
+            printf("移动方向: %s\n", msg->move.direction);
+            robot_move(msg->move.direction, 0);
+        } else if (!has_direction) {
+            printf("移动方向: 停止\n");
+        }
+    } else if (msg->type == WIRE_GET_JPEG) {
+        // 处理获取JPEG图像命令
+        printf("收到获取JPEG图像命令\n");
+        
+        // 拍摄到帧池中的一帧，直接从内存发送
+        CameraFrame *frame = camera_capture(&camera);
+        if (frame) {
+            printf("拍摄图像: 第 %llu 帧 (%s)\n", (unsigned long long)frame->sequence,
+                   camera_source_name(camera.source));
+            send_jpeg_buffer(sock, frame->data, frame->length);
+            camera_release(&camera, frame);
+        } else {
+            printf("拍摄图像失败\n");
+        }
+    } else if (msg->type == WIRE_SUBSCRIBE) {
+        stream_subscribe(&msg->subscribe);
+    }
+}
+
+// 处理一条解码后的服务器消息，JSON 和紧凑编码的消息都转换为 WireMessage
+static void dispatch_server_message(int sock, const WireMessage *msg) {
+    if (msg->type == WIRE_CREDIT) {
+        // 推流期间频繁到达，不打印
+        stream_credit(msg->credit.frames);
+    } else if (wire_command_name(msg->type)) {
+        run_command(sock, msg);
+    } else if (msg->type == WIRE_UPLOAD_URL) {
+        printf("upload_url: %s\n", msg->upload_url.url);
+        if (msg->upload_url.compact) {
+            // 服务器同意了 init_slam 中申请的紧凑编码
+            printf("服务器已启用紧凑编码\n");
+            compact_enabled = 1;
+        }
+    } else {
+        printf("未知消息类型: %d\n", msg->type);
+    }
+}
+
+// 处理一条服务器消息；按需解析并按 wire_messages.def 校验字段，分发过程不分配内存
+void handle_server_message(int sock, const char *buffer, size_t len) {
+    WireMessage msg;
+    if (wire_decode_json(&msg, buffer, len) < 0) {
+        printf("解析服务器消息失败\n");
+        return;
+    }
     
-    return 0;
+    if (msg.type != WIRE_CREDIT) {
+        printf("%.*s\n", (int)len, buffer);
+    }
+    dispatch_server_message(sock, &msg);
+}
+
+// 处理一条紧凑编码的服务器消息
+void handle_server_compact(int sock, const char *buffer, size_t len) {
+    WireMessage msg;
+    if (wire_decode(&msg, (const uint8_t *)buffer, len) < 0) {
+        printf("解析服务器消息失败\n");
+        return;
+    }
+    dispatch_server_message(sock, &msg);
 }
 
 // 处理服务器消息的线程函数
 void *server_handler(void *arg) {
     int sock = *((int *)arg);
-    char buffer[BUFFER_SIZE];
+    FrameBuffer rx;
+    frame_buffer_init(&rx);
     
     while (connected) {
-        int bytes_read = recv(sock, buffer, BUFFER_SIZE - 1, 0);
+        ssize_t bytes_read = frame_buffer_recv(&rx, sock);
         if (bytes_read > 0) {
-            buffer[bytes_read] = '\0';
-            cJSON *root = cJSON_Parse(buffer);
-            if (root) {
-                cJSON *command = cJSON_GetObjectItem(root, "command");
-                cJSON *timestamp = cJSON_GetObjectItem(root, "timestamp");
-                
-                char *json_str = cJSON_Print(root);
-                printf("%s\n", json_str);
-                free(json_str);
-                
-                if (command && timestamp) {
-                    printf("收到命令: %s 时间戳: %.0f\n", 
-                           command->valuestring, timestamp->valuedouble);
-                    
-                    // 处理不同类型的命令
-                    if (strcmp(command->valuestring, "check_status") == 0) {
-                        // 发送状态回复
-                        send_status_response(sock);
-                    } else if (strcmp(command->valuestring, "move") == 0) {
-                        // 处理移动命令
-                        cJSON *direction = cJSON_GetObjectItem(root, "direction");
-                        cJSON *duration = cJSON_GetObjectItem(root, "duration");
-                        
-                        if (direction && duration) {
-                            printf("移动方向: %s 持续时间: %.0f秒\n", 
-                                   direction->valuestring, duration->valuedouble);
-                            robot_move(direction->valuestring, duration->valuedouble);  
-                        } else if (direction && !duration) {
-                            printf("移动方向: %s\n", direction->valuestring);
-                            robot_move(direction->valuestring, 0);
-                        } else if (!direction) {
-                            printf("移动方向: 停止\n");
-                        }
-                    } else if (strcmp(command->valuestring, "get_jpeg") == 0) {
-                        // 处理获取JPEG图像命令
-                        printf("收到获取JPEG图像命令\n");
-                        
-                        // 生成临时文件名
-                        char filename[64];
-                        sprintf(filename, "capture_%ld.jpg", (long)time(NULL));
-                        
-                        // 拍照
-                        if (capture_jpeg(filename) == 0) {
-                            // 发送图像
-                            send_jpeg_image(sock, filename);
-                            
-                            // 删除临时文件
-                            remove(filename);
-                        }
-                    } else {
-                        printf("未知命令: %s\n", command->valuestring);
-                    }
+            // 一次读取可能包含多条消息，也可能只有半条
+            FrameHeader header;
+            const char *payload;
+            int ret;
+            while ((ret = frame_buffer_next(&rx, &header, &payload)) > 0) {
+                if (header.type == FRAME_JSON) {
+                    handle_server_message(sock, payload, header.length);
+                } else if (header.type == FRAME_COMPACT) {
+                    handle_server_compact(sock, payload, header.length);
+                } else {
+                    printf("不支持的帧类型: %d\n", header.type);
+                    ret = -1;
+                    break;
                 }
-                
-                cJSON_Delete(root);
+            }
+            if (ret < 0) {
+                printf("协议错误，断开连接\n");
+                connected = 0;
+                break;
             }
         } else if (bytes_read == 0) {
             printf("服务器断开连接\n");
             connected = 0;
             break;
-        } else if (errno != EAGAIN && errno != EWOULDBLOCK) {
+        } else if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
             perror("接收失败");
             connected = 0;
             break;
         }
     }
     
+    stream_stop();
+    frame_buffer_free(&rx);
     return NULL;
 }
 
@@ -430,17 +778,41 @@ void *connection_thread(void *arg) {
 }
 
 // 主函数
-int main() {
+int main(int argc, char *argv[]) {
     char server_ip[INET_ADDRSTRLEN];
     int server_port = PORT;
     char cmd_buffer[256];
     pthread_t server_thread;
+    const char *source_name = CAMERA_SOURCE;
+    size_t frame_kb = 0;
+    
+    // -c 图像源（test 或 synthetic），-k synthetic 的平均帧大小（KB）
+    int opt;
+    while ((opt = getopt(argc, argv, "c:k:")) != -1) {
+        switch (opt) {
+            case 'c':
+                source_name = optarg;
+                break;
+            case 'k':
+                frame_kb = (size_t)atoi(optarg);
+                break;
+            default:
+                fprintf(stderr, "用法: %s [-c test|synthetic] [-k 平均帧KB]\n", argv[0]);
+                return 1;
+        }
+    }
+    CameraSource *source = camera_source_create(source_name, frame_kb * 1024);
+    if (!source || camera_open(&camera, source) < 0) {
+        fprintf(stderr, "无法打开图像源: %s\n", source_name);
+        return 1;
+    }
     
     // 设置信号处理
     signal(SIGINT, signal_handler);
     signal(SIGTERM, signal_handler);
     
-    printf("客户端启动，等待命令...\n");
+    printf("客户端启动，图像源: %s (每帧最大 %zu 字节)，等待命令...\n", camera_source_name(camera.source),
+           camera_source_max_bytes(camera.source));
     show_help();
     
     while (1) {
@@ -543,9 +915,20 @@ int main() {
         } else if (strcmp(cmd_buffer, "status") == 0) {
             if (connected) {
                 printf("当前已连接到服务器\n");
+                pthread_mutex_lock(&stream.lock);
+                if (stream.running) {
+                    printf("正在推流: %d fps%s, 流控额度 %d 帧\n", stream.fps,
+                           stream.on_change ? "，画面变化时发送" : "", stream.credits);
+                    show_stream_stats("推流统计");
+                }
+                pthread_mutex_unlock(&stream.lock);
             } else {
                 printf("当前未连接到服务器\n");
             }
+            pthread_mutex_lock(&camera.lock);
+            printf("图像源 %s: 已拍摄 %lld 帧, 失败 %lld 帧\n", camera_source_name(camera.source),
+                   camera.captured, camera.failed);
+            pthread_mutex_unlock(&camera.lock);
         } else if (strcmp(cmd_buffer, "help") == 0) {
             show_help();
             
@@ -0,0 +1,97 @@
+#include <stdlib.h>
+#include "cJSON.h"
+#include "json_arena.h"
+
+#define ARENA_INITIAL_SIZE (16 * 1024)
+#define ARENA_ALIGN 16
+
+// 区块放不下时临时分配的溢出块，重置时释放
+typedef struct ArenaChunk {
+    struct ArenaChunk *next;
+    size_t size;
+    char data[];
+} ArenaChunk;
+
+typedef struct {
+    char *block;
+    size_t size;
+    size_t used;
+    ArenaChunk *overflow;
+    size_t overflow_bytes;  // 本轮溢出块的总大小
+} JsonArena;
+
+static __thread JsonArena arena;
+
+static size_t align_up(size_t size) {
+    return (size + ARENA_ALIGN - 1) & ~(size_t)(ARENA_ALIGN - 1);
+}
+
+static void *arena_malloc(size_t size) {
+    size = align_up(size ? size : 1);
+    if (arena.used + size <= arena.size) {
+        void *ptr = arena.block + arena.used;
+        arena.used += size;
+        return ptr;
+    }
+
+    // 区块不够，本轮使用溢出块，重置时再扩大区块
+    ArenaChunk *chunk = malloc(sizeof(ArenaChunk) + size);
+    if (!chunk) {
+        return NULL;
+    }
+    chunk->next = arena.overflow;
+    chunk->size = size;
+    arena.overflow = chunk;
+    arena.overflow_bytes += size;
+    return chunk->data;
+}
+
+static void arena_free(void *ptr) {
+    // 分配区内的内存在重置时统一回收
+    (void)ptr;
+}
+
+int json_arena_install(void) {
+    if (!arena.block) {
+        arena.block = malloc(ARENA_INITIAL_SIZE);
+        if (!arena.block) {
+            return -1;
+        }
+        arena.size = ARENA_INITIAL_SIZE;
+    }
+    cJSON_Hooks hooks = { arena_malloc, arena_free };
+    cJSON_InitHooks(&hooks);
+    return 0;
+}
+
+void json_arena_reset(void) {
+    size_t total = arena.used + arena.overflow_bytes;
+    while (arena.overflow) {
+        ArenaChunk *next = arena.overflow->next;
+        free(arena.overflow);
+        arena.overflow = next;
+    }
+    if (arena.overflow_bytes > 0) {
+        // 按本轮总用量扩大区块，失败时保留原区块
+        size_t size = arena.size;
+        while (size < total) {
+            size *= 2;
+        }
+        char *block = malloc(size);
+        if (block) {
+            free(arena.block);
+            arena.block = block;
+            arena.size = size;
+        }
+    }
+    arena.used = 0;
+    arena.overflow_bytes = 0;
+}
+
+void json_arena_release(void) {
+    json_arena_reset();
+    cJSON_InitHooks(NULL);
+    free(arena.block);
+    arena.block = NULL;
+    arena.size = 0;
+}
@@ -0,0 +1,326 @@
+// JSON 编解码基准：读入协议消息语料（每行一条），对每条编解码路径报告每条消息的耗时、吞吐和分配次数，
+// 用于客观评估 cJSON 和协议编解码的优化效果。通过 make bench 编译运行。
+//
+// 用法：./json_bench [语料文件] [轮数]
+// 分配次数通过链接选项 -Wl,--wrap=malloc 等统计，包括 cJSON 绕过 hooks 直接调用的 malloc。
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "cJSON.h"
+#include "json_arena.h"
+#include "json_index.h"
+#include "json_stream.h"
+#include "wire.h"
+
+#define DEFAULT_CORPUS "bench_corpus.jsonl"
+#define DEFAULT_ROUNDS 2000
+#define MAX_SAMPLES 1024
+
+static size_t alloc_count;
+
+void *__real_malloc(size_t size);
+void *__real_calloc(size_t count, size_t size);
+void *__real_realloc(void *pointer, size_t size);
+
+void *__wrap_malloc(size_t size) {
+    alloc_count++;
+    return __real_malloc(size);
+}
+
+void *__wrap_calloc(size_t count, size_t size) {
+    alloc_count++;
+    return __real_calloc(count, size);
+}
+
+void *__wrap_realloc(void *pointer, size_t size) {
+    alloc_count++;
+    return __real_realloc(pointer, size);
+}
+
+typedef struct {
+    const char *json;
+    size_t len;
+    cJSON *tree;          // 预先解析，供查找和打印路径使用
+    WireMessage msg;      // 预先解码，type 为0表示不是协议消息
+    uint8_t compact[WIRE_MESSAGE_MAX];
+    int compact_len;
+} Sample;
+
+// 处理一条消息，返回处理的字节数；不适用于这条消息返回-1，不计入统计
+typedef long (*BenchFn)(Sample *sample);
+
+typedef struct {
+    const char *name;
+    BenchFn run;
+    void (*setup)(void);
+    void (*teardown)(void);
+} BenchPath;
+
+static volatile size_t sink;  // 防止结果被优化掉
+
+static long bench_cjson_parse(Sample *sample) {
+    cJSON *tree = cJSON_ParseWithLength(sample->json, sample->len);
+    sink += tree != NULL;
+    cJSON_Delete(tree);
+    return (long)sample->len;
+}
+
+static long bench_cjson_parse_document(Sample *sample) {
+    cJSON_Document *document = cJSON_ParseDocument(sample->json, sample->len);
+    sink += document != NULL;
+    cJSON_DeleteDocument(document);
+    return (long)sample->len;
+}
+
+// 分配区在每条消息处理完后重置，与服务器、客户端的用法相同
+static long bench_cjson_parse_arena(Sample *sample) {
+    cJSON *tree = cJSON_ParseWithLength(sample->json, sample->len);
+    sink += tree != NULL;
+    cJSON_Delete(tree);
+    json_arena_reset();
+    return (long)sample->len;
+}
+
+static void arena_setup(void) {
+    json_arena_install();
+}
+
+static void arena_teardown(void) {
+    json_arena_release();
+}
+
+// 按消息中出现的每个键查找一次
+static long bench_cjson_lookup(Sample *sample) {
+    for (const cJSON *child = sample->tree->child; child; child = child->next) {
+        sink += cJSON_GetObjectItem(sample->tree, child->string) != NULL;
+    }
+    return (long)sample->len;
+}
+
+static long bench_cjson_lookup_case_sensitive(Sample *sample) {
+    for (const cJSON *child = sample->tree->child; child; child = child->next) {
+        sink += cJSON_GetObjectItemCaseSensitive(sample->tree, child->string) != NULL;
+    }
+    return (long)sample->len;
+}
+
+static long bench_cjson_print(Sample *sample) {
+    char *text = cJSON_PrintUnformatted(sample->tree);
+    size_t len = strlen(text);
+    sink += len;
+    cJSON_free(text);
+    return (long)len;
+}
+
+static long bench_cjson_print_thread_buffer(Sample *sample) {
+    size_t len = 0;
+    sink += cJSON_PrintThreadBuffer(sample->tree, 0, 0, &len) != NULL;
+    return (long)len;
+}
+
+static void thread_buffer_teardown(void) {
+    cJSON_FreeThreadBuffer();
+}
+
+static long bench_json_index(Sample *sample) {
+    JsonIndex index;
+    sink += json_index_build(&index, sample->json, sample->len) == 0;
+    return (long)sample->len;
+}
+
+static long bench_json_stream(Sample *sample) {
+    JsonStream stream;
+    size_t end = 0;
+    json_stream_init(&stream);
+    sink += json_stream_feed(&stream, sample->json, sample->len, &end);
+    return (long)sample->len;
+}
+
+static long bench_wire_decode_json(Sample *sample) {
+    WireMessage msg;
+    if (sample->msg.type == 0) {
+        return -1;
+    }
+    sink += wire_decode_json(&msg, sample->json, sample->len) == 0;
+    return (long)sample->len;
+}
+
+static long bench_wire_encode_json(Sample *sample) {
+    char out[WIRE_JSON_MAX];
+    if (sample->msg.type == 0) {
+        return -1;
+    }
+    int len = wire_encode_json(&sample->msg, out, sizeof(out));
+    sink += len;
+    return len;
+}
+
+static long bench_wire_decode(Sample *sample) {
+    WireMessage msg;
+    if (sample->msg.type == 0) {
+        return -1;
+    }
+    sink += wire_decode(&msg, sample->compact, sample->compact_len) == 0;
+    return sample->compact_len;
+}
+
+static long bench_wire_encode(Sample *sample) {
+    uint8_t out[WIRE_MESSAGE_MAX];
+    if (sample->msg.type == 0) {
+        return -1;
+    }
+    int len = wire_encode(&sample->msg, out, sizeof(out));
+    sink += len;
+    return len;
+}
+
+static const BenchPath paths[] = {
+    { "cJSON_Parse", bench_cjson_parse, NULL, NULL },
+    { "cJSON_Parse (arena)", bench_cjson_parse_arena, arena_setup, arena_teardown },
+    { "cJSON_ParseDocument", bench_cjson_parse_document, NULL, cJSON_FreeDocumentCache },
+    { "cJSON_GetObjectItem", bench_cjson_lookup, NULL, NULL },
+    { "cJSON_GetObjectItemCaseSensitive", bench_cjson_lookup_case_sensitive, NULL, NULL },
+    { "cJSON_PrintUnformatted", bench_cjson_print, NULL, NULL },
+    { "cJSON_PrintThreadBuffer", bench_cjson_print_thread_buffer, NULL, thread_buffer_teardown },
+    { "json_index_build", bench_json_index, NULL, NULL },
+    { "json_stream_feed", bench_json_stream, NULL, NULL },
+    { "wire_decode_json", bench_wire_decode_json, NULL, NULL },
+    { "wire_encode_json", bench_wire_encode_json, NULL, NULL },
+    { "wire_decode (compact)", bench_wire_decode, NULL, NULL },
+    { "wire_encode (compact)", bench_wire_encode, NULL, NULL },
+};
+
+static double now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+// 读入语料，每个非空行一条消息，返回条数，失败返回-1
+static int load_corpus(const char *path, Sample *samples, int max_samples, char **storage) {
+    FILE *fp = fopen(path, "rb");
+    if (!fp) {
+        perror(path);
+        return -1;
+    }
+    fseek(fp, 0, SEEK_END);
+    long size = ftell(fp);
+    fseek(fp, 0, SEEK_SET);
+    char *data = malloc(size + 1);
+    if (!data || fread(data, 1, size, fp) != (size_t)size) {
+        fclose(fp);
+        free(data);
+        return -1;
+    }
+    fclose(fp);
+    data[size] = '\0';
+    *storage = data;
+
+    int count = 0;
+    for (char *line = data; *line && count < max_samples;) {
+        char *end = strchr(line, '\n');
+        size_t len = end ? (size_t)(end - line) : strlen(line);
+        if (len > 0 && line[len - 1] == '\r') {
+            len--;
+        }
+        if (len > 0) {
+            Sample *sample = &samples[count];
+            memset(sample, 0, sizeof(*sample));
+            sample->json = line;
+            sample->len = len;
+            sample->tree = cJSON_ParseWithLength(line, len);
+            if (!sample->tree) {
+                fprintf(stderr, "第 %d 条消息不是有效的 JSON: %.*s\n", count + 1, (int)len, line);
+                return -1;
+            }
+            if (wire_decode_json(&sample->msg, line, len) < 0) {
+                fprintf(stderr, "第 %d 条消息不符合 wire_messages.def: %.*s\n", count + 1, (int)len, line);
+                return -1;
+            }
+            if (sample->msg.type != 0) {
+                sample->compact_len = wire_encode(&sample->msg, sample->compact, sizeof(sample->compact));
+            }
+            count++;
+        }
+        if (!end) {
+            break;
+        }
+        line = end + 1;
+    }
+    return count;
+}
+
+static void run_path(const BenchPath *path, Sample *samples, int count, int rounds) {
+    if (path->setup) {
+        path->setup();
+    }
+
+    // 预热一轮，让缓存、分配区和线程缓冲区达到稳定状态
+    for (int i = 0; i < count; i++) {
+        path->run(&samples[i]);
+    }
+
+    size_t messages = 0;
+    size_t bytes = 0;
+    size_t allocs = alloc_count;
+    double start = now_ns();
+    for (int round = 0; round < rounds; round++) {
+        for (int i = 0; i < count; i++) {
+            long len = path->run(&samples[i]);
+            if (len >= 0) {
+                messages++;
+                bytes += (size_t)len;
+            }
+        }
+    }
+    double elapsed = now_ns() - start;
+    allocs = alloc_count - allocs;
+
+    if (path->teardown) {
+        path->teardown();
+    }
+    if (messages == 0) {
+        printf("%-34s %10s\n", path->name, "-");
+        return;
+    }
+    printf("%-34s %10.1f %10.1f %10.2f\n", path->name, elapsed / messages, bytes / elapsed * 1e3,
+           (double)allocs / messages);
+}
+
+int main(int argc, char *argv[]) {
+    const char *corpus = argc > 1 ? argv[1] : DEFAULT_CORPUS;
+    int rounds = argc > 2 ? atoi(argv[2]) : DEFAULT_ROUNDS;
+    static Sample samples[MAX_SAMPLES];
+    char *storage = NULL;
+
+    if (rounds <= 0) {
+        fprintf(stderr, "用法: %s [语料文件] [轮数]\n", argv[0]);
+        return 1;
+    }
+    int count = load_corpus(corpus, samples, MAX_SAMPLES, &storage);
+    if (count <= 0) {
+        fprintf(stderr, "无法读取语料 %s\n", corpus);
+        return 1;
+    }
+
+    size_t total = 0;
+    int protocol = 0;
+    for (int i = 0; i < count; i++) {
+        total += samples[i].len;
+        protocol += samples[i].msg.type != 0;
+    }
+    printf("语料: %s，%d 条消息（协议消息 %d 条），共 %zu 字节，平均 %zu 字节；%d 轮\n\n",
+           corpus, count, protocol, total, total / count, rounds);
+    printf("%-34s %10s %10s %10s\n", "path", "ns/msg", "MB/s", "allocs/msg");
+    for (size_t i = 0; i < sizeof(paths) / sizeof(paths[0]); i++) {
+        run_path(&paths[i], samples, count, rounds);
+    }
+
+    for (int i = 0; i < count; i++) {
+        cJSON_Delete(samples[i].tree);
+    }
+    free(storage);
+    return 0;
+}
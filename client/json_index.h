@@ -0,0 +1,58 @@
+#ifndef JSON_INDEX_H
+#define JSON_INDEX_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// 按需解析 JSON 对象，用于消息分发。
+// json_index_build 扫描一遍消息，校验语法，并把顶层成员记录为指向原始缓冲区的片段；
+// 之后只有被取用的字段才会解码（字符串去转义、数字转换）。全程不分配内存，
+// 索引放在调用方的栈上，有效期与消息缓冲区相同。
+//
+// 嵌套的对象和数组只校验不展开，需要时用 json_array_next 逐个取元素。
+// 键按原始字节比较，含转义的键不会被 json_index_get 找到。
+
+#define JSON_INDEX_MAX_FIELDS 32  // 顶层成员上限，超过按格式错误处理
+#define JSON_INDEX_MAX_DEPTH 64   // 嵌套深度上限
+
+// 值的类型
+#define JSON_INDEX_STRING 1
+#define JSON_INDEX_NUMBER 2
+#define JSON_INDEX_TRUE   3
+#define JSON_INDEX_FALSE  4
+#define JSON_INDEX_NULL   5
+#define JSON_INDEX_OBJECT 6
+#define JSON_INDEX_ARRAY  7
+
+typedef struct {
+    const char *data;  // 字符串为引号内的原始内容，其余为值的完整文本
+    size_t len;
+    uint8_t type;
+    uint8_t escaped;   // 字符串中含转义序列
+} JsonValue;
+
+typedef struct {
+    const char *key;   // 引号内的原始内容
+    size_t key_len;
+    JsonValue value;
+} JsonField;
+
+typedef struct {
+    int count;
+    JsonField fields[JSON_INDEX_MAX_FIELDS];
+} JsonIndex;
+
+// 扫描一条顶层为对象的 JSON 消息，格式错误返回-1
+int json_index_build(JsonIndex *index, const char *json, size_t len);
+// 查找键，有重复时返回第一个，不存在返回 NULL
+const JsonValue *json_index_get(const JsonIndex *index, const char *key);
+// 值是否为等于 text 的字符串
+int json_value_equals(const JsonValue *value, const char *text);
+// 把字符串值解码到 out（含结尾0），返回长度；不是字符串或缓冲区不足返回-1
+int json_value_string(const JsonValue *value, char *out, size_t out_size);
+// 取数值，不是数字返回-1
+int json_value_number(const JsonValue *value, double *number);
+// 遍历数组：*cursor 初始为0，取到元素返回1，遍历结束或不是数组返回0
+int json_array_next(const JsonValue *array, size_t *cursor, JsonValue *element);
+
+#endif
@@ -0,0 +1,73 @@
+#include "json_stream.h"
+
+#define STREAM_OUTSIDE 0  // 值开始之前
+#define STREAM_VALUE   1  // 值内，字符串外
+#define STREAM_STRING  2  // 字符串内
+#define STREAM_ESCAPE  3  // 字符串内反斜杠之后
+
+void json_stream_init(JsonStream *stream) {
+    stream->scanned = 0;
+    stream->arrays = 0;
+    stream->depth = 0;
+    stream->state = STREAM_OUTSIDE;
+}
+
+int json_stream_feed(JsonStream *stream, const char *data, size_t len, size_t *end) {
+    size_t i = stream->scanned;
+    uint8_t state = stream->state;
+    uint64_t arrays = stream->arrays;
+    uint32_t depth = stream->depth;
+
+    for (; i < len; i++) {
+        char c = data[i];
+        switch (state) {
+            case STREAM_OUTSIDE:
+                if (c == ' ' || c == '\t' || c == '\n' || c == '\r') {
+                    break;
+                }
+                if (c != '{' && c != '[') {
+                    return -1;
+                }
+                state = STREAM_VALUE;
+                depth = 1;
+                arrays = c == '[';
+                break;
+            case STREAM_VALUE:
+                if (c == '"') {
+                    state = STREAM_STRING;
+                } else if (c == '{' || c == '[') {
+                    if (depth == JSON_STREAM_MAX_DEPTH) {
+                        return -1;
+                    }
+                    arrays = (arrays & ~((uint64_t)1 << depth)) | ((uint64_t)(c == '[') << depth);
+                    depth++;
+                } else if (c == '}' || c == ']') {
+                    if (((arrays >> (depth - 1)) & 1) != (c == ']')) {
+                        return -1;
+                    }
+                    if (--depth == 0) {
+                        *end = i + 1;
+                        json_stream_init(stream);
+                        return 1;
+                    }
+                }
+                break;
+            case STREAM_STRING:
+                if (c == '"') {
+                    state = STREAM_VALUE;
+                } else if (c == '\\') {
+                    state = STREAM_ESCAPE;
+                }
+                break;
+            case STREAM_ESCAPE:
+                state = STREAM_STRING;
+                break;
+        }
+    }
+
+    stream->scanned = i;
+    stream->state = state;
+    stream->arrays = arrays;
+    stream->depth = depth;
+    return 0;
+}
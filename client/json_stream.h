@@ -0,0 +1,27 @@
+#ifndef JSON_STREAM_H
+#define JSON_STREAM_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// 增量（推式）JSON 扫描器，用于从字节流中切分没有帧头的 JSON 消息。
+// 数据可以按任意大小分多次到达，每次调用从上次停下的位置继续，已扫描的字节不会重复扫描；
+// 扫描到一个完整的顶层对象或数组时返回其长度，值本身仍留在调用方的接收缓冲区里，不做拷贝。
+// 只跟踪字符串和括号嵌套，值的完整校验由之后的解析完成。
+
+#define JSON_STREAM_MAX_DEPTH 64
+
+typedef struct {
+    size_t scanned;  // 当前值已扫描的字节数
+    uint64_t arrays; // 每层括号是否为数组，第 n 层对应第 n-1 位
+    uint32_t depth;  // 括号嵌套深度
+    uint8_t state;
+} JsonStream;
+
+void json_stream_init(JsonStream *stream);
+// data 为当前值的开头（包括已经送入过的部分），len 为目前收到的全部长度。
+// 返回1表示 data[0..*end) 是一个完整的值（可能带前导空白），扫描器随即复位，准备下一个值；
+// 返回0表示需要更多数据；返回-1表示格式错误（顶层不是对象或数组、括号不匹配、嵌套过深）
+int json_stream_feed(JsonStream *stream, const char *data, size_t len, size_t *end);
+
+#endif
@@ -0,0 +1,110 @@
+#ifndef WIRE_H
+#define WIRE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// 紧凑二进制消息编码，作为 FRAME_COMPACT 帧的负载。
+// 客户端在 init_slam 中通过 "encodings":["compact"] 申请，服务器在 upload_url 回复中
+// 带 "encoding":"compact" 表示同意；之后双方可以发送紧凑帧，也仍然接受 JSON 帧。
+//
+// 负载格式：[消息类型 1字节] 后跟若干字段，每个字段为 [字段号 1字节][长度 1字节][值]。
+//   字符串：不含结尾0的字节，最长255
+//   整数：zigzag 编码后按大端存放，去掉前导0字节（0的长度为0）
+// 解码时跳过未知字段，便于以后增加字段。
+
+#define WIRE_MESSAGE_MAX 1024  // 编码后的最大长度
+#define WIRE_TEXT_MAX 256      // 字符串字段的缓冲区大小（含结尾0）
+
+// 消息类型，与 README 中的 JSON 消息一一对应
+#define WIRE_INIT         1  // 客户端 -> 服务器：{"reason":..., "rtsp_url":...}
+#define WIRE_UPLOAD_URL   2  // 服务器 -> 客户端：{"upload_url":..., "timestamp":...}
+#define WIRE_CHECK_STATUS 3  // 服务器 -> 客户端：{"command":"check_status", ...}
+#define WIRE_MOVE         4  // 服务器 -> 客户端：{"command":"move", "direction", "duration", ...}
+#define WIRE_GET_JPEG     5  // 服务器 -> 客户端：{"command":"get_jpeg", ...}
+#define WIRE_STATUS       6  // 客户端 -> 服务器：{"status", "battery", "is_moving", "current_position"}
+#define WIRE_JPEG_IMAGE   7  // 客户端 -> 服务器：{"response":"jpeg_image", "timestamp", "size", "stream"}
+#define WIRE_SUBSCRIBE    8  // 服务器 -> 客户端：{"command":"subscribe", "fps", "on_change", "credits", ...}
+#define WIRE_CREDIT       9  // 服务器 -> 客户端：{"command":"credit", "frames"}
+
+// 字段号
+#define WIRE_FIELD_TIMESTAMP 1
+#define WIRE_FIELD_REASON    2
+#define WIRE_FIELD_URL       3  // WIRE_INIT 中为 rtsp_url，WIRE_UPLOAD_URL 中为 upload_url
+#define WIRE_FIELD_DIRECTION 4
+#define WIRE_FIELD_DURATION  5
+#define WIRE_FIELD_STATUS    6
+#define WIRE_FIELD_BATTERY   7
+#define WIRE_FIELD_MOVING    8
+#define WIRE_FIELD_POSITION  9
+#define WIRE_FIELD_SIZE      10
+#define WIRE_FIELD_FPS       11
+#define WIRE_FIELD_ON_CHANGE 12
+#define WIRE_FIELD_CREDITS   13
+#define WIRE_FIELD_FRAMES    14
+#define WIRE_FIELD_STREAM    15
+
+#define WIRE_HAS(msg, field) (((msg)->fields >> (field)) & 1)
+
+#define WIRE_JSON_MAX 4096  // wire_encode_json 输出的最大长度，字符串字段全部转义为 \u00XX 时也能放下
+
+// 字段选项
+#define WIRE_REQUIRED 0
+#define WIRE_OPTIONAL 1
+#define WIRE_OMIT_EMPTY 2  // 可以缺省，编码时空字符串或假值连同键一起省略
+
+// 每种消息的结构体，由 wire_messages.def 生成，如 WireMove { direction, duration, timestamp }
+#define MESSAGE(type, Struct, name, tag) typedef struct {
+#define TAGGED(type, Struct, name, tag, value) typedef struct {
+#define STRING(name, member, number, key, flags) char member[WIRE_TEXT_MAX];
+#define INTEGER(name, member, number, key, flags) int64_t member;
+#define BOOLEAN(name, member, number, key, flags) int member;
+#define FLAG(name, member, key, json, value) int member;
+#define END(Struct, name) } Struct;
+#include "wire_messages.def"
+#undef MESSAGE
+#undef TAGGED
+#undef STRING
+#undef INTEGER
+#undef BOOLEAN
+#undef FLAG
+#undef END
+
+// 解码结果，按 type 取对应的成员，如 msg.move.direction
+typedef struct {
+    uint8_t type;
+    uint32_t fields;  // 解码时出现过的字段，按字段号置位
+    union {
+#define MESSAGE(type, Struct, name, tag)
+#define TAGGED(type, Struct, name, tag, value)
+#define STRING(name, member, number, key, flags)
+#define INTEGER(name, member, number, key, flags)
+#define BOOLEAN(name, member, number, key, flags)
+#define FLAG(name, member, key, json, value)
+#define END(Struct, name) Struct name;
+#include "wire_messages.def"
+    };
+} WireMessage;
+
+#undef MESSAGE
+#undef TAGGED
+#undef STRING
+#undef INTEGER
+#undef BOOLEAN
+#undef FLAG
+#undef END
+
+// 按消息类型写出其全部字段（空字符串省略），返回长度，类型未知或缓冲区不足返回-1
+int wire_encode(const WireMessage *msg, uint8_t *out, size_t out_size);
+// 按预编译的模板写出与 README 一致的 JSON（不含结尾0），返回长度，类型未知或缓冲区不足返回-1。
+// 输出与用 cJSON 构造同样的对象再 cJSON_PrintUnformatted 逐字节相同（整数字段绝对值小于1e15）
+int wire_encode_json(const WireMessage *msg, char *out, size_t out_size);
+// 解码一条紧凑消息，格式错误、缺少必需字段返回-1
+int wire_decode(WireMessage *msg, const uint8_t *data, size_t len);
+// 解码一条 JSON 消息并按 wire_messages.def 校验字段，全程不分配内存。
+// 格式错误、缺少必需字段、字段类型不符或字符串超出缓冲区返回-1；不是已知的消息返回0，type 为0
+int wire_decode_json(WireMessage *msg, const char *json, size_t len);
+// 命令消息在 JSON 中的 "command" 名称，不是命令时返回 NULL
+const char *wire_command_name(uint8_t type);
+
+#endif
@@ -120,6 +120,9 @@ typedef struct cJSON
 
     /* The item's name string, if this item is the child of, or is in the list of subitems of an object. */
     char *string;
+    /* Case-insensitive hash of string, maintained by cJSON to speed up GetObjectItem.
+     * 0 means not computed; reset it to 0 if you assign string yourself. */
+    unsigned int string_hash;
 } cJSON;
 
 typedef struct cJSON_Hooks
@@ -146,7 +149,10 @@ typedef int cJSON_bool;
 /* returns the version of cJSON as a string */
 CJSON_PUBLIC(const char*) cJSON_Version(void);
 
-/* Supply malloc, realloc and free functions to cJSON */
+/* Supply malloc, realloc and free functions to cJSON.
+ * Hooks are per thread: they apply to cJSON calls made by the calling thread only, so a thread
+ * can install its own allocator (e.g. an arena) without racing with other threads. Items must
+ * be deleted and printed buffers freed on a thread using the same hooks that allocated them. */
 CJSON_PUBLIC(void) cJSON_InitHooks(cJSON_Hooks* hooks);
 
 /* Memory Management: the caller is always responsible to free the results from all variants of cJSON_Parse (with cJSON_Delete) and cJSON_Print (with stdlib free, cJSON_Hooks.free_fn, or cJSON_free as appropriate). The exception is cJSON_PrintPreallocated, where the caller has full responsibility of the buffer. */
@@ -158,6 +164,17 @@ CJSON_PUBLIC(cJSON *) cJSON_ParseWithLength(const char *value, size_t buffer_len
 CJSON_PUBLIC(cJSON *) cJSON_ParseWithOpts(const char *value, const char **return_parse_end, cJSON_bool require_null_terminated);
 CJSON_PUBLIC(cJSON *) cJSON_ParseWithLengthOpts(const char *value, size_t buffer_length, const char **return_parse_end, cJSON_bool require_null_terminated);
 
+/* Documents: parse into slabs owned by a document handle instead of allocating every node and string separately.
+ * A small message fits in one slab, deleting the document releases all of it at once, and released slabs are
+ * cached per thread so steady-state parsing does not allocate. Nodes of a document must not be passed to
+ * cJSON_Delete or cJSON_Detach*, and nodes allocated elsewhere must not be added to it. */
+typedef struct cJSON_Document cJSON_Document;
+CJSON_PUBLIC(cJSON_Document *) cJSON_ParseDocument(const char *value, size_t buffer_length);
+CJSON_PUBLIC(cJSON *) cJSON_DocumentRoot(const cJSON_Document *document);
+CJSON_PUBLIC(void) cJSON_DeleteDocument(cJSON_Document *document);
+/* Release the slabs cached by the calling thread, e.g. before the thread exits. */
+CJSON_PUBLIC(void) cJSON_FreeDocumentCache(void);
+
 /* Render a cJSON entity to text for transfer/storage. */
 CJSON_PUBLIC(char *) cJSON_Print(const cJSON *item);
 /* Render a cJSON entity to text for transfer/storage without any formatting. */
@@ -167,6 +184,15 @@ CJSON_PUBLIC(char *) cJSON_PrintBuffered(const cJSON *item, int prebuffer, cJSON
 /* Render a cJSON entity to text using a buffer already allocated in memory with given length. Returns 1 on success and 0 on failure. */
 /* NOTE: cJSON is not always 100% accurate in estimating how much memory it will use, so to be safe allocate 5 bytes more than you actually need */
 CJSON_PUBLIC(cJSON_bool) cJSON_PrintPreallocated(cJSON *item, char *buffer, const int length, const cJSON_bool format);
+/* Exact length of the text cJSON_Print (format=1) or cJSON_PrintUnformatted (format=0) would produce, without the terminator. Returns 0 if the item can't be printed. */
+CJSON_PUBLIC(size_t) cJSON_PrintedLength(const cJSON *item, cJSON_bool format);
+/* Render into a buffer owned by the calling thread that is kept and grown across calls, so steady-state printing does not allocate.
+ * With exact_size the output is measured first and the buffer grown at most once; otherwise it grows by doubling while printing.
+ * The result must not be freed and is valid until the next call on the same thread; *length (if not NULL) receives its length.
+ * Returns NULL on failure. The buffer always comes from malloc, independent of cJSON_InitHooks. */
+CJSON_PUBLIC(const char *) cJSON_PrintThreadBuffer(const cJSON *item, cJSON_bool format, cJSON_bool exact_size, size_t *length);
+/* Release the calling thread's print buffer, e.g. before the thread exits. */
+CJSON_PUBLIC(void) cJSON_FreeThreadBuffer(void);
 /* Delete a cJSON entity and all subentities. */
 CJSON_PUBLIC(void) cJSON_Delete(cJSON *item);
 
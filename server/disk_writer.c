@@ -0,0 +1,249 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include "disk_writer.h"
+#include "reactor_uring.h"
+
+static long long elapsed_ns(const struct timespec *start, const struct timespec *end) {
+    return (end->tv_sec - start->tv_sec) * 1000000000LL + (end->tv_nsec - start->tv_nsec);
+}
+
+static void release_budget(DiskWriter *writer, size_t size) {
+    __atomic_sub_fetch(&writer->reserved, size, __ATOMIC_RELAXED);
+}
+
+#if defined(__linux__) && defined(USE_IO_URING)
+// 整批图像先分配位置，数据写入一次提交给 io_uring，一批只需一次系统调用；
+// 提交失败或只写了一部分的图像由 image_store_finish 用 pwrite 补写
+static void append_batch_uring(DiskWriter *writer, UringWriter *uring, DiskJob **jobs, int count,
+                               StoreEntry *entries, int *ok) {
+    StoreSlot slots[DISK_BATCH_MAX];
+    int results[DISK_BATCH_MAX];
+    int reserved[DISK_BATCH_MAX];
+    int submitted = 0;
+
+    for (int i = 0; i < count; i++) {
+        results[i] = 0;
+        reserved[i] = image_store_reserve(writer->store, jobs[i]->robot, jobs[i]->timestamp,
+                                          jobs[i]->size, &slots[i]) == 0;
+        if (reserved[i] && jobs[i]->size > 0 &&
+            uring_writer_write(uring, slots[i].fd, jobs[i]->data, jobs[i]->size, slots[i].offset, i) == 0) {
+            submitted++;
+        }
+    }
+    if (submitted > 0 && uring_writer_wait(uring, results, submitted) < 0) {
+        // 没能提交的图像 results 仍为0，下面整张补写
+        perror("io_uring 写盘失败");
+    }
+
+    for (int i = 0; i < count; i++) {
+        ok[i] = 0;
+        if (reserved[i]) {
+            if (results[i] < 0) {
+                errno = -results[i];
+            }
+            ok[i] = image_store_finish(writer->store, &slots[i], jobs[i]->robot, jobs[i]->timestamp,
+                                       jobs[i]->data, results[i], &entries[i]) == 0;
+        }
+        if (!ok[i]) {
+            perror("写入图像数据失败");
+        }
+    }
+}
+#endif
+
+// 写入一批任务：依次追加到存储，整批提交一次，最后释放任务。
+// uring 非空时整批数据一次提交给 io_uring 写入
+static void write_batch(DiskWriter *writer, DiskJob **jobs, int count, UringWriter *uring) {
+    StoreEntry entries[DISK_BATCH_MAX];
+    int ok[DISK_BATCH_MAX];
+    long long written = 0, failed = 0, bytes = 0;
+
+#if defined(__linux__) && defined(USE_IO_URING)
+    if (uring) {
+        append_batch_uring(writer, uring, jobs, count, entries, ok);
+    } else
+#else
+    (void)uring;
+#endif
+    for (int i = 0; i < count; i++) {
+        ok[i] = image_store_append(writer->store, jobs[i]->robot, jobs[i]->timestamp,
+                                   jobs[i]->data, jobs[i]->size, &entries[i]) == 0;
+        if (!ok[i]) {
+            perror("写入图像数据失败");
+        }
+    }
+
+    // 组提交：一批图像只写一次索引，开启同步时数据和索引各 fdatasync 一次
+    if (image_store_commit(writer->store, writer->sync) < 0) {
+        for (int i = 0; i < count; i++) {
+            ok[i] = 0;
+        }
+    }
+
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    long long latency_total = 0, latency_max = 0;
+    for (int i = 0; i < count; i++) {
+        long long latency = elapsed_ns(&jobs[i]->queued, &now);
+        latency_total += latency;
+        if (latency > latency_max) {
+            latency_max = latency;
+        }
+        if (ok[i]) {
+            written++;
+            bytes += jobs[i]->size;
+            if (!jobs[i]->quiet) {
+                char path[256];
+                image_store_segment_path(writer->store, entries[i].segment, path, sizeof(path));
+                printf("图像已保存至 %s@%llu (写盘延迟 %.2f ms)\n", path,
+                       (unsigned long long)entries[i].offset, latency / 1e6);
+            }
+        } else {
+            failed++;
+        }
+        release_budget(writer, jobs[i]->size);
+        free(jobs[i]);
+    }
+
+    pthread_mutex_lock(&writer->lock);
+    writer->stats.written += written;
+    writer->stats.failed += failed;
+    writer->stats.bytes += bytes;
+    writer->stats.batches++;
+    writer->stats.latency_ns_total += latency_total;
+    if (latency_max > writer->stats.latency_ns_max) {
+        writer->stats.latency_ns_max = latency_max;
+    }
+    pthread_mutex_unlock(&writer->lock);
+}
+
+static void *disk_writer_thread(void *arg) {
+    DiskWriter *writer = arg;
+    DiskJob *jobs[DISK_BATCH_MAX];
+    UringWriter *uring = NULL;
+#if defined(__linux__) && defined(USE_IO_URING)
+    // 内核不支持时逐张 pwrite
+    uring = uring_writer_create();
+#endif
+
+    while (1) {
+        pthread_mutex_lock(&writer->lock);
+        while (!writer->head && !writer->stopping) {
+            pthread_cond_wait(&writer->ready, &writer->lock);
+        }
+        // 停止时先写完队列
+        if (!writer->head) {
+            pthread_mutex_unlock(&writer->lock);
+            break;
+        }
+        int count = 0;
+        while (writer->head && count < DISK_BATCH_MAX) {
+            jobs[count++] = writer->head;
+            writer->head = writer->head->next;
+        }
+        if (!writer->head) {
+            writer->tail = &writer->head;
+        }
+        writer->stats.queued -= count;
+        pthread_mutex_unlock(&writer->lock);
+
+        write_batch(writer, jobs, count, uring);
+    }
+#if defined(__linux__) && defined(USE_IO_URING)
+    uring_writer_destroy(uring);
+#endif
+    return NULL;
+}
+
+int disk_writer_start(DiskWriter *writer, ImageStore *store, int threads, size_t budget, int sync) {
+    memset(writer, 0, sizeof(*writer));
+    pthread_mutex_init(&writer->lock, NULL);
+    pthread_cond_init(&writer->ready, NULL);
+    writer->tail = &writer->head;
+    writer->store = store;
+    writer->budget = budget;
+    writer->sync = sync;
+
+    writer->threads = calloc(threads, sizeof(pthread_t));
+    if (!writer->threads) {
+        return -1;
+    }
+    for (int i = 0; i < threads; i++) {
+        if (pthread_create(&writer->threads[i], NULL, disk_writer_thread, writer) != 0) {
+            perror("create disk writer thread failed");
+            disk_writer_stop(writer);
+            return -1;
+        }
+        writer->thread_count++;
+    }
+    return 0;
+}
+
+void disk_writer_stop(DiskWriter *writer) {
+    pthread_mutex_lock(&writer->lock);
+    writer->stopping = 1;
+    pthread_cond_broadcast(&writer->ready);
+    pthread_mutex_unlock(&writer->lock);
+
+    for (int i = 0; i < writer->thread_count; i++) {
+        pthread_join(writer->threads[i], NULL);
+    }
+    writer->thread_count = 0;
+    free(writer->threads);
+    writer->threads = NULL;
+}
+
+DiskJob *disk_job_create(DiskWriter *writer, size_t size) {
+    size_t reserved = __atomic_load_n(&writer->reserved, __ATOMIC_RELAXED);
+    do {
+        if (size > writer->budget || reserved > writer->budget - size) {
+            __atomic_add_fetch(&writer->rejected, 1, __ATOMIC_RELAXED);
+            return NULL;
+        }
+    } while (!__atomic_compare_exchange_n(&writer->reserved, &reserved, reserved + size, 1,
+                                          __ATOMIC_RELAXED, __ATOMIC_RELAXED));
+
+    DiskJob *job = malloc(sizeof(DiskJob) + size);
+    if (!job) {
+        release_budget(writer, size);
+        __atomic_add_fetch(&writer->rejected, 1, __ATOMIC_RELAXED);
+        return NULL;
+    }
+    job->next = NULL;
+    job->robot[0] = '\0';
+    job->quiet = 0;
+    job->size = size;
+    return job;
+}
+
+void disk_job_discard(DiskWriter *writer, DiskJob *job) {
+    release_budget(writer, job->size);
+    free(job);
+}
+
+void disk_writer_submit(DiskWriter *writer, DiskJob *job) {
+    job->next = NULL;
+    struct timespec now;
+    clock_gettime(CLOCK_REALTIME, &now);
+    job->timestamp = now.tv_sec * 1000000000LL + now.tv_nsec;
+    clock_gettime(CLOCK_MONOTONIC, &job->queued);
+
+    pthread_mutex_lock(&writer->lock);
+    *writer->tail = job;
+    writer->tail = &job->next;
+    if (++writer->stats.queued > writer->stats.queued_max) {
+        writer->stats.queued_max = writer->stats.queued;
+    }
+    pthread_cond_signal(&writer->ready);
+    pthread_mutex_unlock(&writer->lock);
+}
+
+void disk_writer_stats(DiskWriter *writer, DiskWriterStats *stats) {
+    pthread_mutex_lock(&writer->lock);
+    *stats = writer->stats;
+    pthread_mutex_unlock(&writer->lock);
+    stats->reserved = __atomic_load_n(&writer->reserved, __ATOMIC_RELAXED);
+    stats->rejected = __atomic_load_n(&writer->rejected, __ATOMIC_RELAXED);
+}
@@ -0,0 +1,71 @@
+#ifndef DISK_WRITER_H
+#define DISK_WRITER_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <time.h>
+#include <pthread.h>
+#include "image_store.h"
+
+// 图像写盘线程池。事件循环把收完的图像连同缓冲区的所有权交给写盘线程，不拷贝数据，
+// 自身不做任何磁盘操作：追加到图像存储（image_store.h）、写索引、fsync 都在写盘线程中进行。
+//
+// 内存有上限：开始接收一张图像前先按其大小预留，写完后归还；预留不到时由调用方丢弃这张图像，
+// 事件循环不会因为磁盘慢而阻塞。
+// 每个写盘线程一次取出一批任务依次追加，整批追加完后提交一次；开启同步时一批只 fdatasync 一次（组提交）。
+
+#define DISK_BATCH_MAX 16  // 每个写盘线程一次取出的任务上限
+
+typedef struct DiskJob {
+    struct DiskJob *next;
+    char robot[STORE_ROBOT_MAX];  // 机器人标识（客户端IP）
+    int64_t timestamp;        // 接收完成时的时间（纳秒，CLOCK_REALTIME），作为图像的时间戳
+    struct timespec queued;   // 提交时间，用于统计写盘延迟
+    size_t size;
+    int quiet;                // 推流帧，写完后不逐张打印
+    char data[];              // 图像数据，由事件循环直接接收进来
+} DiskJob;
+
+// 写盘统计，延迟为从提交到写完（开启同步时包括 fsync）的时间
+typedef struct {
+    long long written;    // 已写入的图像数
+    long long failed;     // 写入失败的图像数
+    long long rejected;   // 预留不到内存而被丢弃的图像数
+    long long bytes;      // 已写入的字节数
+    long long batches;    // 写盘线程取出的批数
+    long long latency_ns_total;
+    long long latency_ns_max;
+    int queued;           // 当前队列深度
+    int queued_max;       // 队列深度峰值
+    size_t reserved;      // 已预留的字节数（接收中和等待写盘的图像）
+} DiskWriterStats;
+
+typedef struct {
+    pthread_mutex_t lock;
+    pthread_cond_t ready;  // 有新任务或正在停止
+    DiskJob *head;
+    DiskJob **tail;
+    int stopping;
+    int sync;              // 提交时 fdatasync
+    ImageStore *store;
+    size_t budget;         // 预留上限
+    size_t reserved;       // 原子更新
+    long long rejected;    // 原子更新
+    int thread_count;
+    pthread_t *threads;
+    DiskWriterStats stats; // 由 lock 保护，其中的 reserved 和 rejected 不使用
+} DiskWriter;
+
+// 启动写盘线程，图像追加到已打开的 store；budget 为接收中和等待写盘的图像数据总量上限
+int disk_writer_start(DiskWriter *writer, ImageStore *store, int threads, size_t budget, int sync);
+// 写完队列中的所有任务后停止写盘线程
+void disk_writer_stop(DiskWriter *writer);
+// 预留内存并分配一个任务，超出上限或分配失败返回 NULL
+DiskJob *disk_job_create(DiskWriter *writer, size_t size);
+// 放弃一个尚未提交的任务
+void disk_job_discard(DiskWriter *writer, DiskJob *job);
+// 提交任务，之后任务归写盘线程所有
+void disk_writer_submit(DiskWriter *writer, DiskJob *job);
+void disk_writer_stats(DiskWriter *writer, DiskWriterStats *stats);
+
+#endif
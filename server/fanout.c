@@ -0,0 +1,212 @@
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include "frame.h"
+#include "fanout.h"
+
+#ifdef __linux__
+#include <sys/eventfd.h>
+#endif
+
+
+OutMsg *outmsg_create(uint8_t type, const void *payload, size_t length) {
+    OutMsg *msg = malloc(sizeof(OutMsg) + FRAME_HEADER_SIZE + length);
+    if (!msg) {
+        return NULL;
+    }
+    msg->refs = 1;
+    msg->compact = NULL;
+    msg->wire_type = 0;
+    msg->max_age_ns = 0;
+    msg->stream_window = 0;
+    msg->length = FRAME_HEADER_SIZE + length;
+    frame_header_encode((uint8_t *)msg->data, type, (uint32_t)length);
+    memcpy(msg->data + FRAME_HEADER_SIZE, payload, length);
+    return msg;
+}
+
+OutMsg *outmsg_create_json(const char *json) {
+    return outmsg_create(FRAME_JSON, json, strlen(json));
+}
+
+OutMsg *outmsg_create_unframed(const OutMsg *framed) {
+    size_t length = framed->length - FRAME_HEADER_SIZE;
+    OutMsg *msg = malloc(sizeof(OutMsg) + length);
+    if (!msg) {
+        return NULL;
+    }
+    msg->refs = 1;
+    msg->compact = NULL;
+    msg->wire_type = 0;
+    msg->max_age_ns = 0;
+    msg->stream_window = 0;
+    msg->length = length;
+    memcpy(msg->data, framed->data + FRAME_HEADER_SIZE, length);
+    return msg;
+}
+
+OutMsg *outmsg_ref(OutMsg *msg) {
+    __atomic_add_fetch(&msg->refs, 1, __ATOMIC_RELAXED);
+    return msg;
+}
+
+void outmsg_unref(OutMsg *msg) {
+    if (msg && __atomic_sub_fetch(&msg->refs, 1, __ATOMIC_ACQ_REL) == 0) {
+        outmsg_unref(msg->compact);
+        free(msg);
+    }
+}
+
+void outqueue_init(OutQueue *queue) {
+    memset(queue, 0, sizeof(*queue));
+}
+
+int outqueue_push(OutQueue *queue, OutMsg *msg) {
+    OutItem *item = malloc(sizeof(OutItem));
+    if (!item) {
+        return -1;
+    }
+    item->msg = outmsg_ref(msg);
+    item->next = NULL;
+    if (queue->tail) {
+        queue->tail->next = item;
+    } else {
+        queue->head = item;
+    }
+    queue->tail = item;
+    queue->bytes += msg->length;
+    return 0;
+}
+
+// 释放队首已经发送完的消息
+static void outqueue_pop(OutQueue *queue) {
+    OutItem *item = queue->head;
+    queue->head = item->next;
+    if (!queue->head) {
+        queue->tail = NULL;
+    }
+    outmsg_unref(item->msg);
+    free(item);
+}
+
+int outqueue_prepare(OutQueue *queue, struct iovec *iov, int max) {
+    int iovcnt = 0;
+    size_t offset = queue->offset;
+    for (OutItem *item = queue->head; item && iovcnt < max; item = item->next) {
+        iov[iovcnt].iov_base = item->msg->data + offset;
+        iov[iovcnt].iov_len = item->msg->length - offset;
+        iovcnt++;
+        offset = 0;
+    }
+    return iovcnt;
+}
+
+void outqueue_consume(OutQueue *queue, size_t n) {
+    queue->bytes -= n;
+    while (n > 0) {
+        size_t left = queue->head->msg->length - queue->offset;
+        if (n < left) {
+            queue->offset += n;
+            break;
+        }
+        n -= left;
+        queue->offset = 0;
+        outqueue_pop(queue);
+    }
+}
+
+int outqueue_flush(OutQueue *queue, int sock) {
+    while (queue->head) {
+        // 一次写出多条排队消息
+        struct iovec iov[OUTQUEUE_MAX_IOV];
+        struct msghdr msg;
+        memset(&msg, 0, sizeof(msg));
+        msg.msg_iov = iov;
+        msg.msg_iovlen = outqueue_prepare(queue, iov, OUTQUEUE_MAX_IOV);
+        ssize_t n = sendmsg(sock, &msg, MSG_NOSIGNAL | MSG_DONTWAIT);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                return 0;
+            }
+            return -1;
+        }
+        outqueue_consume(queue, (size_t)n);
+    }
+    return 1;
+}
+
+void outqueue_clear(OutQueue *queue) {
+    while (queue->head) {
+        outqueue_pop(queue);
+    }
+    outqueue_init(queue);
+}
+
+int mailbox_init(Mailbox *mailbox) {
+    memset(mailbox, 0, sizeof(*mailbox));
+#ifdef __linux__
+    int fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (fd < 0) {
+        return -1;
+    }
+    mailbox->wake_fd[0] = mailbox->wake_fd[1] = fd;
+#else
+    if (pipe(mailbox->wake_fd) < 0) {
+        return -1;
+    }
+    fcntl(mailbox->wake_fd[0], F_SETFL, O_NONBLOCK);
+    fcntl(mailbox->wake_fd[1], F_SETFL, O_NONBLOCK);
+#endif
+    return 0;
+}
+
+int mailbox_post(Mailbox *mailbox, OutMsg *msg) {
+    OutItem *item = malloc(sizeof(OutItem));
+    if (!item) {
+        return -1;
+    }
+    item->msg = outmsg_ref(msg);
+
+    OutItem *head = __atomic_load_n(&mailbox->head, __ATOMIC_RELAXED);
+    do {
+        item->next = head;
+    } while (!__atomic_compare_exchange_n(&mailbox->head, &head, item, 1,
+                                          __ATOMIC_RELEASE, __ATOMIC_RELAXED));
+
+    // 只有空队列变为非空时才需要唤醒
+    return head == NULL ? mailbox_wake(mailbox) : 0;
+}
+
+int mailbox_wake(Mailbox *mailbox) {
+    uint64_t one = 1;
+    if (write(mailbox->wake_fd[1], &one, sizeof(one)) < 0 && errno != EAGAIN) {
+        return -1;
+    }
+    return 0;
+}
+
+OutItem *mailbox_take_all(Mailbox *mailbox) {
+    uint64_t value;
+    while (read(mailbox->wake_fd[0], &value, sizeof(value)) > 0) {
+    }
+
+    // 先清除唤醒状态再取链表，之后投递的消息会重新唤醒
+    OutItem *items = __atomic_exchange_n(&mailbox->head, NULL, __ATOMIC_ACQUIRE);
+
+    // 恢复投递顺序
+    OutItem *ordered = NULL;
+    while (items) {
+        OutItem *next = items->next;
+        items->next = ordered;
+        ordered = items;
+        items = next;
+    }
+    return ordered;
+}
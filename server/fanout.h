@@ -0,0 +1,67 @@
+#ifndef FANOUT_H
+#define FANOUT_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/uio.h>
+
+#define OUTQUEUE_MAX_IOV 16  // 一次写出的最大消息数
+
+// 编码一次、由多个连接共享的出站消息（含帧头），引用计数为0时释放
+typedef struct OutMsg {
+    int refs;
+    struct OutMsg *compact;  // 同一条消息的紧凑编码，协商了紧凑协议的连接发送它，可为 NULL
+    uint8_t wire_type;       // 协议消息类型（WIRE_*），0 表示未设置；分片据此更新客户端状态
+    int64_t max_age_ns;      // get_jpeg：图像缓存中有不超过该时间的图像的客户端不发送，0 表示都发送
+    int stream_window;       // subscribe：推流的流控窗口（帧），0 表示停止推流
+    size_t length;
+    char data[];
+} OutMsg;
+
+OutMsg *outmsg_create(uint8_t type, const void *payload, size_t length);
+OutMsg *outmsg_create_json(const char *json);
+// 去掉帧头的副本，发给没有帧头的旧协议连接
+OutMsg *outmsg_create_unframed(const OutMsg *framed);
+OutMsg *outmsg_ref(OutMsg *msg);
+void outmsg_unref(OutMsg *msg);
+
+typedef struct OutItem {
+    OutMsg *msg;
+    struct OutItem *next;
+} OutItem;
+
+// 每个连接的出站队列，由非阻塞写出
+typedef struct {
+    OutItem *head;
+    OutItem *tail;
+    size_t offset;  // 队首消息已发送的字节数
+    size_t bytes;   // 队列中尚未发送的字节数
+} OutQueue;
+
+void outqueue_init(OutQueue *queue);
+// 入队并持有一个引用
+int outqueue_push(OutQueue *queue, OutMsg *msg);
+// 尽量写出队列，返回1表示已写完，0表示还有数据（等待可写），-1表示连接出错
+int outqueue_flush(OutQueue *queue, int sock);
+// 由调用方自己写出（如提交给 io_uring）：prepare 填入队首最多 max 条消息的 iovec，返回条数；
+// 写出 n 字节后 consume 释放已写完的消息。两次调用之间只能向队尾入队
+int outqueue_prepare(OutQueue *queue, struct iovec *iov, int max);
+void outqueue_consume(OutQueue *queue, size_t n);
+void outqueue_clear(OutQueue *queue);
+
+// 其他线程向事件循环投递广播消息，通过 wake_fd 唤醒事件循环。
+// 多个投递方、单个接收方，无锁：投递时原子地压入链表头，接收方一次取走整条链表。
+typedef struct {
+    OutItem *head;   // 按投递的逆序串接
+    int wake_fd[2];  // [0] 注册到事件循环，[1] 用于写入唤醒（eventfd 时两者相同）
+} Mailbox;
+
+int mailbox_init(Mailbox *mailbox);
+// 投递消息，持有一个引用
+int mailbox_post(Mailbox *mailbox, OutMsg *msg);
+// 不投递消息，只唤醒事件循环（如通知其退出）
+int mailbox_wake(Mailbox *mailbox);
+// 取出所有已投递的消息（按投递顺序），并清除唤醒状态
+OutItem *mailbox_take_all(Mailbox *mailbox);
+
+#endif
@@ -0,0 +1,228 @@
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include "frame.h"
+
+#define FRAME_BUFFER_INITIAL 4096
+#define FRAME_SEND_TIMEOUT_MS 1000
+
+void frame_header_encode(uint8_t *out, uint8_t type, uint32_t length) {
+    out[0] = FRAME_MAGIC;
+    out[1] = type;
+    out[2] = 0;
+    out[3] = 0;
+    out[4] = (uint8_t)(length >> 24);
+    out[5] = (uint8_t)(length >> 16);
+    out[6] = (uint8_t)(length >> 8);
+    out[7] = (uint8_t)length;
+}
+
+int frame_header_decode(const uint8_t *in, FrameHeader *header) {
+    if (in[0] != FRAME_MAGIC) {
+        return -1;
+    }
+    header->type = in[1];
+    header->length = ((uint32_t)in[4] << 24) | ((uint32_t)in[5] << 16) |
+                     ((uint32_t)in[6] << 8) | (uint32_t)in[7];
+    return 0;
+}
+
+void frame_buffer_init(FrameBuffer *buffer) {
+    memset(buffer, 0, sizeof(*buffer));
+}
+
+void frame_buffer_free(FrameBuffer *buffer) {
+    free(buffer->data);
+    frame_buffer_init(buffer);
+}
+
+void frame_buffer_shrink(FrameBuffer *buffer) {
+    if (buffer->start == buffer->end) {
+        // 连接的帧模式要保留
+        int mode = buffer->mode;
+        frame_buffer_free(buffer);
+        buffer->mode = mode;
+    }
+}
+
+// 保证缓冲区末尾至少还能写入 need 字节
+static int frame_buffer_reserve(FrameBuffer *buffer, size_t need) {
+    if (buffer->capacity - buffer->end >= need) {
+        return 0;
+    }
+
+    // 先把未处理的数据挪到开头
+    if (buffer->start > 0) {
+        memmove(buffer->data, buffer->data + buffer->start, buffer->end - buffer->start);
+        buffer->end -= buffer->start;
+        buffer->start = 0;
+        if (buffer->capacity - buffer->end >= need) {
+            return 0;
+        }
+    }
+
+    size_t capacity = buffer->capacity ? buffer->capacity : FRAME_BUFFER_INITIAL;
+    while (capacity - buffer->end < need) {
+        capacity *= 2;
+    }
+    char *data = realloc(buffer->data, capacity);
+    if (!data) {
+        return -1;
+    }
+    buffer->data = data;
+    buffer->capacity = capacity;
+    return 0;
+}
+
+ssize_t frame_buffer_recv(FrameBuffer *buffer, int sock) {
+    if (buffer->start == buffer->end) {
+        buffer->start = buffer->end = 0;
+    }
+    if (frame_buffer_reserve(buffer, FRAME_BUFFER_INITIAL / 2) < 0) {
+        errno = ENOMEM;
+        return -1;
+    }
+
+    ssize_t n = recv(sock, buffer->data + buffer->end, buffer->capacity - buffer->end, 0);
+    if (n > 0) {
+        buffer->end += n;
+    }
+    return n;
+}
+
+int frame_buffer_append(FrameBuffer *buffer, const void *data, size_t len) {
+    if (buffer->start == buffer->end) {
+        buffer->start = buffer->end = 0;
+    }
+    if (frame_buffer_reserve(buffer, len) < 0) {
+        errno = ENOMEM;
+        return -1;
+    }
+    memcpy(buffer->data + buffer->end, data, len);
+    buffer->end += len;
+    return 0;
+}
+
+// 没有帧头的连接：从上次停下的位置继续扫描，切出下一条完整的 JSON 消息
+static int frame_buffer_next_unframed(FrameBuffer *buffer, FrameHeader *header, const char **payload) {
+    size_t available = buffer->end - buffer->start;
+    size_t length;
+    int ret = json_stream_feed(&buffer->json, buffer->data + buffer->start, available, &length);
+    if (ret < 0 || (ret == 0 && available > FRAME_MAX_MESSAGE)) {
+        return -1;
+    }
+    if (ret == 0) {
+        return 0;
+    }
+
+    header->type = FRAME_JSON;
+    header->length = (uint32_t)length;
+    *payload = buffer->data + buffer->start;
+    buffer->start += length;
+    return 1;
+}
+
+int frame_buffer_next(FrameBuffer *buffer, FrameHeader *header, const char **payload) {
+    size_t available = buffer->end - buffer->start;
+    if (buffer->mode == FRAME_MODE_UNKNOWN && available > 0) {
+        buffer->mode = buffer->data[buffer->start] == '{' ? FRAME_MODE_UNFRAMED : FRAME_MODE_FRAMED;
+    }
+    if (buffer->mode == FRAME_MODE_UNFRAMED) {
+        return frame_buffer_next_unframed(buffer, header, payload);
+    }
+    if (available < FRAME_HEADER_SIZE) {
+        return 0;
+    }
+
+    if (frame_header_decode((const uint8_t *)buffer->data + buffer->start, header) < 0) {
+        return -1;
+    }
+
+    if (header->type == FRAME_BINARY) {
+        buffer->start += FRAME_HEADER_SIZE;
+        *payload = NULL;
+        return 1;
+    }
+
+    if (header->length > FRAME_MAX_MESSAGE) {
+        return -1;
+    }
+    if (available < FRAME_HEADER_SIZE + header->length) {
+        // 为剩余部分预留空间，下一次 recv 可以一次读完
+        if (frame_buffer_reserve(buffer, FRAME_HEADER_SIZE + header->length - available) < 0) {
+            return -1;
+        }
+        return 0;
+    }
+
+    *payload = buffer->data + buffer->start + FRAME_HEADER_SIZE;
+    buffer->start += FRAME_HEADER_SIZE + header->length;
+    return 1;
+}
+
+size_t frame_buffer_take(FrameBuffer *buffer, size_t max, const char **data) {
+    size_t n = buffer->end - buffer->start;
+    if (n > max) {
+        n = max;
+    }
+    *data = buffer->data + buffer->start;
+    buffer->start += n;
+    return n;
+}
+
+int frame_sendv(int sock, struct iovec *iov, int iovcnt, int flags) {
+    struct msghdr msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = iov;
+    msg.msg_iovlen = iovcnt;
+
+    while (msg.msg_iovlen > 0) {
+        ssize_t n = sendmsg(sock, &msg, flags | MSG_NOSIGNAL);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                // 非阻塞套接字发送缓冲区满，等待可写
+                struct pollfd pfd = { sock, POLLOUT, 0 };
+                if (poll(&pfd, 1, FRAME_SEND_TIMEOUT_MS) <= 0) {
+                    errno = ETIMEDOUT;
+                    return -1;
+                }
+                continue;
+            }
+            return -1;
+        }
+
+        // 跳过已经发送的部分
+        while (msg.msg_iovlen > 0 && (size_t)n >= msg.msg_iov[0].iov_len) {
+            n -= msg.msg_iov[0].iov_len;
+            msg.msg_iov++;
+            msg.msg_iovlen--;
+        }
+        if (msg.msg_iovlen > 0) {
+            msg.msg_iov[0].iov_base = (char *)msg.msg_iov[0].iov_base + n;
+            msg.msg_iov[0].iov_len -= n;
+        }
+    }
+    return 0;
+}
+
+int frame_send(int sock, uint8_t type, const void *payload, size_t length) {
+    uint8_t header[FRAME_HEADER_SIZE];
+    frame_header_encode(header, type, (uint32_t)length);
+
+    struct iovec iov[2];
+    iov[0].iov_base = header;
+    iov[0].iov_len = FRAME_HEADER_SIZE;
+    iov[1].iov_base = (void *)payload;
+    iov[1].iov_len = length;
+    return frame_sendv(sock, iov, 2, 0);
+}
+
+int frame_send_json(int sock, const char *json) {
+    return frame_send(sock, FRAME_JSON, json, strlen(json));
+}
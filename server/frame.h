@@ -0,0 +1,75 @@
+#ifndef FRAME_H
+#define FRAME_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include "json_stream.h"
+
+// 非 Linux 平台没有 MSG_NOSIGNAL
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0
+#endif
+
+// 帧格式：8字节头 + 负载
+//   [0]   FRAME_MAGIC
+//   [1]   帧类型
+//   [2-3] 保留，置0
+//   [4-7] 负载长度（网络字节序）
+#define FRAME_MAGIC 0xA5
+#define FRAME_HEADER_SIZE 8
+#define FRAME_MAX_MESSAGE (64 * 1024)  // JSON/紧凑消息的最大长度
+
+#define FRAME_JSON   1  // 负载为一条 JSON 消息
+#define FRAME_BINARY 2  // 负载为二进制数据（图像），可以流式读取
+#define FRAME_COMPACT 3  // 负载为一条紧凑二进制编码的消息（见 wire.h），握手协商后使用
+
+typedef struct {
+    uint8_t type;
+    uint32_t length;
+} FrameHeader;
+
+// 连接的第一个字节是 '{' 时按没有帧头的旧协议处理：消息是首尾相接的 JSON 对象，
+// 由 JsonStream 增量切分，每条作为一个 FRAME_JSON 帧返回；图像数据紧跟在图像头之后，
+// 调用方按图像头中的大小用 frame_buffer_take 取出
+#define FRAME_MODE_UNKNOWN  0
+#define FRAME_MODE_FRAMED   1
+#define FRAME_MODE_UNFRAMED 2
+
+// 每个连接一个的接收重组缓冲区
+typedef struct {
+    char *data;
+    size_t start;  // 未处理数据的起点
+    size_t end;    // 已接收数据的末尾
+    size_t capacity;
+    int mode;      // 由收到的第一个字节决定
+    JsonStream json;
+} FrameBuffer;
+
+void frame_header_encode(uint8_t *out, uint8_t type, uint32_t length);
+int frame_header_decode(const uint8_t *in, FrameHeader *header);
+
+void frame_buffer_init(FrameBuffer *buffer);
+void frame_buffer_free(FrameBuffer *buffer);
+// 缓冲区中没有未处理的数据时释放内存，用于控制空闲连接的内存占用
+void frame_buffer_shrink(FrameBuffer *buffer);
+// 从套接字读取一次数据追加到缓冲区，返回值同 recv()
+ssize_t frame_buffer_recv(FrameBuffer *buffer, int sock);
+// 追加已经由别处接收的数据（如 io_uring 的完成事件），返回0成功，-1失败
+int frame_buffer_append(FrameBuffer *buffer, const void *data, size_t len);
+// 取出下一帧：返回1表示得到一帧，0表示数据不完整，-1表示协议错误。
+// JSON 帧的负载在下一次 frame_buffer_recv 之前有效；
+// 二进制帧只取出帧头，负载由调用方通过 frame_buffer_take 或直接从套接字读取。
+int frame_buffer_next(FrameBuffer *buffer, FrameHeader *header, const char **payload);
+// 从缓冲区取出最多 max 字节已接收的数据，返回实际取出的字节数
+size_t frame_buffer_take(FrameBuffer *buffer, size_t max, const char **data);
+
+// 把 iov 中的数据全部写出，处理部分写入，iov 会被修改。返回0成功，-1失败
+int frame_sendv(int sock, struct iovec *iov, int iovcnt, int flags);
+// 发送一帧，帧头和负载合并为一次写入，返回0成功，-1失败
+int frame_send(int sock, uint8_t type, const void *payload, size_t length);
+int frame_send_json(int sock, const char *json);
+
+#endif
@@ -0,0 +1,216 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "frame_cache.h"
+
+#define PAGE_ALIGN(n) (((n) + 4095) & ~(size_t)4095)
+
+void frame_cache_name(const char *robot, char *name, size_t size) {
+    snprintf(name, size, "/robot_frames.%s", robot);
+}
+
+static uint32_t hash_robot(const char *robot) {
+    uint32_t hash = 2166136261u;
+    for (const unsigned char *p = (const unsigned char *)robot; *p; p++) {
+        hash = (hash ^ *p) * 16777619u;
+    }
+    return hash;
+}
+
+void frame_cache_init(FrameCache *cache, uint32_t slot_count, uint32_t slot_bytes) {
+    memset(cache, 0, sizeof(*cache));
+    pthread_mutex_init(&cache->lock, NULL);
+    cache->slot_count = slot_count;
+    cache->slot_bytes = slot_bytes;
+}
+
+void frame_cache_close(FrameCache *cache) {
+    for (int i = 0; i < FRAME_CACHE_BUCKETS; i++) {
+        FrameRing *ring = cache->buckets[i];
+        while (ring) {
+            FrameRing *next = ring->next;
+            char name[FRAME_CACHE_NAME_MAX + 16];
+            frame_cache_name(ring->robot, name, sizeof(name));
+            shm_unlink(name);
+            frame_ring_close(ring);
+            pthread_mutex_destroy(&ring->lock);
+            free(ring);
+            ring = next;
+        }
+        cache->buckets[i] = NULL;
+    }
+    cache->rings = 0;
+}
+
+// 创建（或重新初始化上次留下的）共享内存对象并映射
+static FrameRing *ring_create(FrameCache *cache, const char *robot) {
+    char name[FRAME_CACHE_NAME_MAX + 16];
+    frame_cache_name(robot, name, sizeof(name));
+    int fd = shm_open(name, O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        perror("create frame cache failed");
+        return NULL;
+    }
+
+    size_t data_offset = PAGE_ALIGN(sizeof(FrameRingHeader) + cache->slot_count * sizeof(FrameSlot));
+    size_t map_size = data_offset + (size_t)cache->slot_count * cache->slot_bytes;
+    void *map = MAP_FAILED;
+    if (ftruncate(fd, (off_t)map_size) == 0) {
+        map = mmap(NULL, map_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    }
+    close(fd);
+    if (map == MAP_FAILED) {
+        perror("map frame cache failed");
+        shm_unlink(name);
+        return NULL;
+    }
+
+    FrameRing *ring = calloc(1, sizeof(FrameRing));
+    if (!ring) {
+        munmap(map, map_size);
+        shm_unlink(name);
+        return NULL;
+    }
+    snprintf(ring->robot, sizeof(ring->robot), "%s", robot);
+    pthread_mutex_init(&ring->lock, NULL);
+    ring->header = map;
+    ring->data = (char *)map + data_offset;
+    ring->map_size = map_size;
+
+    // 头部最后写 magic，读者看到 magic 时其他字段已经有效
+    FrameRingHeader *header = ring->header;
+    __atomic_store_n(&header->magic, 0, __ATOMIC_RELAXED);
+    header->slot_count = cache->slot_count;
+    header->slot_bytes = cache->slot_bytes;
+    header->data_offset = (uint32_t)data_offset;
+    header->latest = 0;
+    memset(header->slots, 0, cache->slot_count * sizeof(FrameSlot));
+    __atomic_store_n(&header->magic, FRAME_CACHE_MAGIC, __ATOMIC_RELEASE);
+    return ring;
+}
+
+FrameRing *frame_cache_get(FrameCache *cache, const char *robot, int create) {
+    uint32_t bucket = hash_robot(robot) % FRAME_CACHE_BUCKETS;
+    pthread_mutex_lock(&cache->lock);
+    FrameRing *ring = cache->buckets[bucket];
+    while (ring && strcmp(ring->robot, robot) != 0) {
+        ring = ring->next;
+    }
+    if (!ring && create) {
+        ring = ring_create(cache, robot);
+        if (ring) {
+            ring->next = cache->buckets[bucket];
+            cache->buckets[bucket] = ring;
+            __atomic_add_fetch(&cache->rings, 1, __ATOMIC_RELAXED);
+        }
+    }
+    pthread_mutex_unlock(&cache->lock);
+    return ring;
+}
+
+int frame_ring_publish(FrameRing *ring, const void *data, size_t length, int64_t timestamp) {
+    FrameRingHeader *header = ring->header;
+    if (length > header->slot_bytes) {
+        return -1;
+    }
+
+    pthread_mutex_lock(&ring->lock);
+    uint64_t sequence = header->latest + 1;
+    uint32_t index = (uint32_t)((sequence - 1) % header->slot_count);
+    FrameSlot *slot = &header->slots[index];
+
+    // 先把槽位标记为写入中，读者据此丢弃读到一半的数据
+    __atomic_store_n(&slot->seq, sequence * 2 - 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    memcpy(ring->data + (size_t)index * header->slot_bytes, data, length);
+    __atomic_store_n(&slot->timestamp, timestamp, __ATOMIC_RELAXED);
+    __atomic_store_n(&slot->length, (uint32_t)length, __ATOMIC_RELAXED);
+    __atomic_store_n(&slot->seq, sequence * 2, __ATOMIC_RELEASE);
+    __atomic_store_n(&header->latest, sequence, __ATOMIC_RELEASE);
+    pthread_mutex_unlock(&ring->lock);
+    return 0;
+}
+
+int64_t frame_ring_timestamp(const FrameRing *ring) {
+    FrameView view;
+    return frame_ring_latest(ring, 0, &view) == 0 ? view.timestamp : 0;
+}
+
+int frame_ring_open(FrameRing *ring, const char *robot) {
+    char name[FRAME_CACHE_NAME_MAX + 16];
+    memset(ring, 0, sizeof(*ring));
+    frame_cache_name(robot, name, sizeof(name));
+    int fd = shm_open(name, O_RDONLY | O_CLOEXEC, 0);
+    if (fd < 0) {
+        return -1;
+    }
+    struct stat st;
+    void *map = MAP_FAILED;
+    if (fstat(fd, &st) == 0 && (size_t)st.st_size >= sizeof(FrameRingHeader)) {
+        map = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    }
+    close(fd);
+    if (map == MAP_FAILED) {
+        return -1;
+    }
+
+    const FrameRingHeader *header = map;
+    size_t map_size = (size_t)st.st_size;
+    if (__atomic_load_n(&header->magic, __ATOMIC_ACQUIRE) != FRAME_CACHE_MAGIC || header->slot_count == 0 ||
+        header->data_offset < sizeof(FrameRingHeader) + header->slot_count * sizeof(FrameSlot) ||
+        header->data_offset + (size_t)header->slot_count * header->slot_bytes > map_size) {
+        munmap(map, map_size);
+        return -1;
+    }
+    snprintf(ring->robot, sizeof(ring->robot), "%s", robot);
+    ring->header = map;
+    ring->data = (char *)map + header->data_offset;
+    ring->map_size = map_size;
+    return 0;
+}
+
+void frame_ring_close(FrameRing *ring) {
+    if (ring->header) {
+        munmap(ring->header, ring->map_size);
+        ring->header = NULL;
+    }
+}
+
+int frame_ring_latest(const FrameRing *ring, uint32_t age, FrameView *view) {
+    const FrameRingHeader *header = ring->header;
+    if (age >= header->slot_count) {
+        return -1;
+    }
+
+    // 槽位正好在被改写时重试，连续失败说明写入比读取快得多
+    for (int attempt = 0; attempt < 16; attempt++) {
+        uint64_t latest = __atomic_load_n(&header->latest, __ATOMIC_ACQUIRE);
+        if (latest <= age) {
+            return -1;
+        }
+        uint64_t sequence = latest - age;
+        uint32_t index = (uint32_t)((sequence - 1) % header->slot_count);
+        const FrameSlot *slot = &header->slots[index];
+        if (__atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE) != sequence * 2) {
+            continue;
+        }
+        view->timestamp = __atomic_load_n(&slot->timestamp, __ATOMIC_RELAXED);
+        view->length = __atomic_load_n(&slot->length, __ATOMIC_RELAXED);
+        view->data = ring->data + (size_t)index * header->slot_bytes;
+        view->sequence = sequence;
+        view->slot = slot;
+        if (view->length <= header->slot_bytes && frame_view_valid(view)) {
+            return 0;
+        }
+    }
+    return -1;
+}
+
+int frame_view_valid(const FrameView *view) {
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    return __atomic_load_n(&view->slot->seq, __ATOMIC_RELAXED) == view->sequence * 2;
+}
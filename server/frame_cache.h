@@ -0,0 +1,84 @@
+#ifndef FRAME_CACHE_H
+#define FRAME_CACHE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <pthread.h>
+
+// 每个机器人最近 N 帧图像的共享内存环，名为 /robot_frames.<IP>（Linux 上即 /dev/shm/robot_frames.<IP>）。
+// 服务器收完一张图像后写入环中最旧的槽位并记下接收时间，操作员请求图像时缓存中足够新的图像不必重新拍摄上传。
+//
+// 其他本地进程只读映射同一个共享内存对象即可直接读取图像，不经过服务器、不拷贝：
+// 每个槽位带序号（seqlock），写入中为奇数，写完为帧序号的两倍。读者取得最新帧的视图后直接使用映射中的数据，
+// 用完再用 frame_view_valid 确认这段时间内槽位没有被改写；改写之前还要再写入 N-1 帧，通常足够读完。
+
+#define FRAME_CACHE_MAGIC 0x52464D52u  // "RMFR"
+#define FRAME_CACHE_NAME_MAX 64
+
+typedef struct {
+    uint64_t seq;        // 写入中为奇数，写完为帧序号 * 2，0 表示空
+    int64_t timestamp;   // 接收完成时间，纳秒，CLOCK_REALTIME
+    uint32_t length;
+    uint32_t reserved;
+} FrameSlot;
+
+// 共享内存布局：头部之后从 data_offset 开始依次为 slot_count 个 slot_bytes 大小的数据区
+typedef struct {
+    uint32_t magic;
+    uint32_t slot_count;
+    uint32_t slot_bytes;   // 每帧的最大长度，更大的图像不缓存
+    uint32_t data_offset;  // 按页对齐
+    uint64_t latest;       // 最新一帧的序号（从1开始），0 表示还没有图像；第 n 帧在槽位 (n-1) % slot_count
+    FrameSlot slots[];
+} FrameRingHeader;
+
+typedef struct FrameRing {
+    struct FrameRing *next;  // 同一哈希桶
+    char robot[FRAME_CACHE_NAME_MAX];
+    FrameRingHeader *header;
+    char *data;
+    size_t map_size;
+    pthread_mutex_t lock;    // 同一机器人可能有多个连接在不同的事件循环线程中写入
+} FrameRing;
+
+// 读者取得的一帧，data 直接指向共享内存
+typedef struct {
+    const char *data;
+    uint32_t length;
+    int64_t timestamp;
+    uint64_t sequence;
+    const FrameSlot *slot;
+} FrameView;
+
+#define FRAME_CACHE_BUCKETS 1024
+
+// 服务器端：按机器人建立的环，连接断开后保留，机器人重连后继续使用
+typedef struct {
+    pthread_mutex_t lock;
+    uint32_t slot_count;
+    uint32_t slot_bytes;
+    FrameRing *buckets[FRAME_CACHE_BUCKETS];
+    int rings;
+} FrameCache;
+
+void frame_cache_init(FrameCache *cache, uint32_t slot_count, uint32_t slot_bytes);
+// 删除所有共享内存对象
+void frame_cache_close(FrameCache *cache);
+// 取得机器人的环，create 时第一次使用创建共享内存对象；没有或失败返回 NULL
+FrameRing *frame_cache_get(FrameCache *cache, const char *robot, int create);
+// 写入一帧，图像超过槽位大小时返回-1
+int frame_ring_publish(FrameRing *ring, const void *data, size_t length, int64_t timestamp);
+// 最新一帧的接收时间，没有图像返回0
+int64_t frame_ring_timestamp(const FrameRing *ring);
+
+// 读者：只读映射机器人的环，失败返回-1
+int frame_ring_open(FrameRing *ring, const char *robot);
+void frame_ring_close(FrameRing *ring);
+// 取得最新一帧（age 为 0）或之前第 age 帧的视图，没有返回-1
+int frame_ring_latest(const FrameRing *ring, uint32_t age, FrameView *view);
+// 视图中的数据是否仍未被改写，读完数据后调用
+int frame_view_valid(const FrameView *view);
+// 共享内存对象名，如 /robot_frames.192.168.1.10
+void frame_cache_name(const char *robot, char *name, size_t size);
+
+#endif
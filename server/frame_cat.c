@@ -0,0 +1,45 @@
+// 从服务器的共享内存图像缓存中读出一个机器人的图像，不经过服务器。
+// 数据直接从映射写出，不拷贝；写出期间槽位被改写时报错退出。
+//
+// 用法：./frame_cat <机器人IP> [第几新的帧，0为最新] > image.jpg
+// 图像的接收时间和长度输出到标准错误。
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "frame_cache.h"
+
+int main(int argc, char *argv[]) {
+    if (argc < 2) {
+        fprintf(stderr, "用法: %s <机器人IP> [第几新的帧，0为最新] > image.jpg\n", argv[0]);
+        return 1;
+    }
+    uint32_t age = argc > 2 ? (uint32_t)atoi(argv[2]) : 0;
+
+    FrameRing ring;
+    if (frame_ring_open(&ring, argv[1]) < 0) {
+        fprintf(stderr, "没有机器人 %s 的图像缓存\n", argv[1]);
+        return 1;
+    }
+
+    FrameView view;
+    int ret = 1;
+    if (frame_ring_latest(&ring, age, &view) < 0) {
+        fprintf(stderr, "缓存中没有这一帧\n");
+    } else if (fwrite(view.data, 1, view.length, stdout) != view.length || fflush(stdout) != 0) {
+        perror("write");
+    } else if (!frame_view_valid(&view)) {
+        // 写出期间服务器又收到了一整圈图像，已写出的数据不完整
+        fprintf(stderr, "读取期间图像被改写，请重试\n");
+    } else {
+        struct timespec now;
+        clock_gettime(CLOCK_REALTIME, &now);
+        long long age_ns = now.tv_sec * 1000000000LL + now.tv_nsec - view.timestamp;
+        fprintf(stderr, "机器人 %s 第 %llu 帧，%u 字节，%.0f ms 前接收\n", argv[1],
+                (unsigned long long)view.sequence, view.length, age_ns / 1e6);
+        ret = 0;
+    }
+
+    frame_ring_close(&ring);
+    return ret;
+}
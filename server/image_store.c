@@ -0,0 +1,638 @@
+#ifdef __linux__
+#define _GNU_SOURCE  // fallocate()
+#endif
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <dirent.h>
+#include <time.h>
+#include <sys/stat.h>
+#include "image_store.h"
+
+#define ROBOT_TABLE_INITIAL 64
+#define INDEX_INITIAL 64
+
+// 索引文件中的一条记录
+typedef struct {
+    char robot[STORE_ROBOT_MAX];
+    int64_t timestamp;
+    uint64_t offset;
+    uint32_t length;
+    uint32_t checksum;  // 前面各字段的 FNV-1a，用于识别写了一半的记录
+} StoreRecord;
+
+struct StoreSegment {
+    uint32_t id;
+    int data_fd;
+    int index_fd;
+    uint64_t capacity;    // 预分配大小
+    uint64_t used;        // 已分配出去的字节数
+    int sealed;           // 不再追加
+    int refs;             // 正在写入、提交或读取的线程数，为0时才能删除
+    int64_t newest;       // 段内最新图像的时间戳
+    StoreRecord *pending; // 数据已写入、索引记录尚未写入
+    size_t pending_count;
+    size_t pending_capacity;
+};
+
+static uint32_t fnv1a(const void *data, size_t len, uint32_t hash) {
+    const unsigned char *p = data;
+    for (size_t i = 0; i < len; i++) {
+        hash = (hash ^ p[i]) * 16777619u;
+    }
+    return hash;
+}
+
+static uint32_t record_checksum(const StoreRecord *record) {
+    return fnv1a(record, offsetof(StoreRecord, checksum), 2166136261u);
+}
+
+static int pwrite_all(int fd, const char *data, size_t len, uint64_t offset) {
+    while (len > 0) {
+        ssize_t n = pwrite(fd, data, len, (off_t)offset);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return -1;
+        }
+        data += n;
+        len -= n;
+        offset += n;
+    }
+    return 0;
+}
+
+static int write_all(int fd, const char *data, size_t len) {
+    while (len > 0) {
+        ssize_t n = write(fd, data, len);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return -1;
+        }
+        data += n;
+        len -= n;
+    }
+    return 0;
+}
+
+static int pread_all(int fd, char *data, size_t len, uint64_t offset) {
+    while (len > 0) {
+        ssize_t n = pread(fd, data, len, (off_t)offset);
+        if (n <= 0) {
+            if (n < 0 && errno == EINTR) {
+                continue;
+            }
+            return -1;
+        }
+        data += n;
+        len -= n;
+        offset += n;
+    }
+    return 0;
+}
+
+static void segment_file(const ImageStore *store, uint32_t id, const char *ext, char *path, size_t size) {
+    snprintf(path, size, "%s/segment-%08u.%s", store->dir, id, ext);
+}
+
+void image_store_segment_path(const ImageStore *store, uint32_t id, char *path, size_t size) {
+    segment_file(store, id, "dat", path, size);
+}
+
+// ---- 内存索引 ----
+
+static StoreRobot *robot_slot(StoreRobot *table, size_t capacity, const char *robot) {
+    size_t mask = capacity - 1;
+    size_t i = fnv1a(robot, strlen(robot), 2166136261u) & mask;
+    while (table[i].robot[0] && strcmp(table[i].robot, robot) != 0) {
+        i = (i + 1) & mask;
+    }
+    return &table[i];
+}
+
+static StoreRobot *robot_find(ImageStore *store, const char *robot, int create) {
+    if (store->robot_capacity == 0) {
+        if (!create) {
+            return NULL;
+        }
+    } else {
+        StoreRobot *slot = robot_slot(store->robots, store->robot_capacity, robot);
+        if (slot->robot[0] || !create) {
+            return slot->robot[0] ? slot : NULL;
+        }
+    }
+
+    // 装载率超过一半时扩大
+    if ((store->robot_count + 1) * 2 > store->robot_capacity) {
+        size_t capacity = store->robot_capacity ? store->robot_capacity * 2 : ROBOT_TABLE_INITIAL;
+        StoreRobot *table = calloc(capacity, sizeof(StoreRobot));
+        if (!table) {
+            return NULL;
+        }
+        for (size_t i = 0; i < store->robot_capacity; i++) {
+            if (store->robots[i].robot[0]) {
+                *robot_slot(table, capacity, store->robots[i].robot) = store->robots[i];
+            }
+        }
+        free(store->robots);
+        store->robots = table;
+        store->robot_capacity = capacity;
+    }
+
+    StoreRobot *slot = robot_slot(store->robots, store->robot_capacity, robot);
+    snprintf(slot->robot, sizeof(slot->robot), "%s", robot);
+    store->robot_count++;
+    return slot;
+}
+
+// 第一个时间戳不小于 timestamp 的位置
+static size_t lower_bound(const StoreRobot *robot, int64_t timestamp) {
+    size_t low = 0, high = robot->count;
+    while (low < high) {
+        size_t mid = low + (high - low) / 2;
+        if (robot->entries[mid].timestamp < timestamp) {
+            low = mid + 1;
+        } else {
+            high = mid;
+        }
+    }
+    return low;
+}
+
+// 按时间插入；图像基本按时间到达，通常追加在末尾
+static int index_insert(ImageStore *store, const char *robot_name, const StoreEntry *entry) {
+    StoreRobot *robot = robot_find(store, robot_name, 1);
+    if (!robot) {
+        return -1;
+    }
+    if (robot->count == robot->capacity) {
+        size_t capacity = robot->capacity ? robot->capacity * 2 : INDEX_INITIAL;
+        StoreEntry *entries = realloc(robot->entries, capacity * sizeof(StoreEntry));
+        if (!entries) {
+            return -1;
+        }
+        robot->entries = entries;
+        robot->capacity = capacity;
+    }
+
+    size_t pos = robot->count;
+    if (pos > 0 && robot->entries[pos - 1].timestamp > entry->timestamp) {
+        pos = lower_bound(robot, entry->timestamp + 1);
+        memmove(&robot->entries[pos + 1], &robot->entries[pos], (robot->count - pos) * sizeof(StoreEntry));
+    }
+    robot->entries[pos] = *entry;
+    robot->count++;
+    store->images++;
+    return 0;
+}
+
+// 删除段号小于 first 的所有条目
+static void index_drop_before(ImageStore *store, uint32_t first) {
+    for (size_t i = 0; i < store->robot_capacity; i++) {
+        StoreRobot *robot = &store->robots[i];
+        size_t kept = 0;
+        for (size_t j = 0; j < robot->count; j++) {
+            if (robot->entries[j].segment >= first) {
+                robot->entries[kept++] = robot->entries[j];
+            }
+        }
+        store->images -= (long long)(robot->count - kept);
+        robot->count = kept;
+    }
+}
+
+// ---- 段 ----
+
+static void segment_free(StoreSegment *segment) {
+    close(segment->data_fd);
+    close(segment->index_fd);
+    free(segment->pending);
+    free(segment);
+}
+
+static int segment_add(ImageStore *store, StoreSegment *segment) {
+    if (store->segment_count == store->segment_capacity) {
+        int capacity = store->segment_capacity ? store->segment_capacity * 2 : 16;
+        StoreSegment **segments = realloc(store->segments, capacity * sizeof(StoreSegment *));
+        if (!segments) {
+            return -1;
+        }
+        store->segments = segments;
+        store->segment_capacity = capacity;
+    }
+    store->segments[store->segment_count++] = segment;
+    return 0;
+}
+
+static StoreSegment *segment_open(ImageStore *store, uint32_t id, int create) {
+    char path[512];
+    StoreSegment *segment = calloc(1, sizeof(StoreSegment));
+    if (!segment) {
+        return NULL;
+    }
+    segment->id = id;
+    segment->index_fd = -1;
+    segment->newest = INT64_MIN;
+
+    segment_file(store, id, "dat", path, sizeof(path));
+    segment->data_fd = open(path, O_RDWR | O_CLOEXEC | (create ? O_CREAT | O_TRUNC : 0), 0644);
+    segment_file(store, id, "idx", path, sizeof(path));
+    if (segment->data_fd >= 0) {
+        segment->index_fd = open(path, O_RDWR | O_APPEND | O_CREAT | O_CLOEXEC | (create ? O_TRUNC : 0), 0644);
+    }
+    if (segment->index_fd < 0) {
+        perror("open image segment failed");
+        if (segment->data_fd >= 0) {
+            close(segment->data_fd);
+        }
+        free(segment);
+        return NULL;
+    }
+    return segment;
+}
+
+// 新建一个段作为追加目标，预分配空间但不改变文件长度
+static StoreSegment *segment_create(ImageStore *store, uint64_t capacity) {
+    StoreSegment *segment = segment_open(store, store->next_id, 1);
+    if (!segment) {
+        return NULL;
+    }
+#ifdef __linux__
+    fallocate(segment->data_fd, FALLOC_FL_KEEP_SIZE, 0, (off_t)capacity);
+#endif
+    segment->capacity = capacity;
+    if (segment_add(store, segment) < 0) {
+        segment_free(segment);
+        return NULL;
+    }
+    store->next_id++;
+    store->dir_dirty = 1;
+    return segment;
+}
+
+// 不再追加，释放文件末尾之后的预分配空间
+static void segment_seal(StoreSegment *segment) {
+    if (!segment->sealed) {
+        segment->sealed = 1;
+        if (ftruncate(segment->data_fd, (off_t)segment->used) < 0) {
+            perror("truncate image segment failed");
+        }
+    }
+}
+
+static StoreSegment *segment_find(ImageStore *store, uint32_t id) {
+    int low = 0, high = store->segment_count;
+    while (low < high) {
+        int mid = (low + high) / 2;
+        if (store->segments[mid]->id < id) {
+            low = mid + 1;
+        } else {
+            high = mid;
+        }
+    }
+    return low < store->segment_count && store->segments[low]->id == id ? store->segments[low] : NULL;
+}
+
+// 从最旧的段开始删除超过保留期的段，遇到仍在使用的段为止
+static void drop_expired(ImageStore *store, int64_t now) {
+    if (store->retention_ns <= 0) {
+        return;
+    }
+    int dropped = 0;
+    while (dropped < store->segment_count - 1) {
+        StoreSegment *segment = store->segments[dropped];
+        if (!segment->sealed || segment->refs > 0 || segment->pending_count > 0 ||
+            segment->newest >= now - store->retention_ns) {
+            break;
+        }
+        char path[512];
+        segment_file(store, segment->id, "dat", path, sizeof(path));
+        unlink(path);
+        segment_file(store, segment->id, "idx", path, sizeof(path));
+        unlink(path);
+        segment_free(segment);
+        dropped++;
+    }
+    if (dropped > 0) {
+        store->segment_count -= dropped;
+        memmove(store->segments, store->segments + dropped, store->segment_count * sizeof(StoreSegment *));
+        index_drop_before(store, store->segments[0]->id);
+    }
+}
+
+// 加载一个已有段的索引记录，丢弃末尾写了一半的记录
+static int segment_load(ImageStore *store, StoreSegment *segment) {
+    struct stat st;
+    if (fstat(segment->data_fd, &st) < 0) {
+        return -1;
+    }
+    segment->capacity = segment->used = (uint64_t)st.st_size;
+    segment_seal(segment);
+
+    StoreRecord records[256];
+    uint64_t pos = 0;
+    ssize_t n;
+    while ((n = pread(segment->index_fd, records, sizeof(records), (off_t)pos)) > 0) {
+        size_t count = (size_t)n / sizeof(StoreRecord);
+        for (size_t i = 0; i < count; i++) {
+            StoreRecord *record = &records[i];
+            if (record->checksum != record_checksum(record) || record->offset + record->length > segment->used) {
+                n = 0;
+                count = i;
+                break;
+            }
+            record->robot[STORE_ROBOT_MAX - 1] = '\0';
+            StoreEntry entry = { record->timestamp, segment->id, record->length, record->offset };
+            if (index_insert(store, record->robot, &entry) < 0) {
+                return -1;
+            }
+            if (record->timestamp > segment->newest) {
+                segment->newest = record->timestamp;
+            }
+        }
+        pos += count * sizeof(StoreRecord);
+        if ((size_t)n < sizeof(records)) {
+            break;
+        }
+    }
+    if (ftruncate(segment->index_fd, (off_t)pos) < 0) {
+        perror("truncate image index failed");
+    }
+    return 0;
+}
+
+static int compare_id(const void *a, const void *b) {
+    uint32_t x = *(const uint32_t *)a, y = *(const uint32_t *)b;
+    return x < y ? -1 : x > y;
+}
+
+int image_store_open(ImageStore *store, const char *dir, uint64_t segment_size, int64_t retention_ns) {
+    memset(store, 0, sizeof(*store));
+    pthread_mutex_init(&store->lock, NULL);
+    pthread_mutex_init(&store->commit_lock, NULL);
+    store->dir = dir;
+    store->segment_size = segment_size;
+    store->retention_ns = retention_ns;
+    store->next_id = 1;
+
+    if (mkdir(dir, 0755) < 0 && errno != EEXIST) {
+        perror("create image directory failed");
+        return -1;
+    }
+    DIR *d = opendir(dir);
+    if (!d) {
+        perror("open image directory failed");
+        return -1;
+    }
+    uint32_t *ids = NULL;
+    size_t count = 0, capacity = 0;
+    struct dirent *ent;
+    while ((ent = readdir(d)) != NULL) {
+        uint32_t id;
+        char ext[4];
+        if (sscanf(ent->d_name, "segment-%8u.%3s", &id, ext) != 2 || strcmp(ext, "dat") != 0) {
+            continue;
+        }
+        if (count == capacity) {
+            capacity = capacity ? capacity * 2 : 64;
+            uint32_t *grown = realloc(ids, capacity * sizeof(uint32_t));
+            if (!grown) {
+                break;
+            }
+            ids = grown;
+        }
+        ids[count++] = id;
+    }
+    closedir(d);
+
+    if (count > 1) {
+        qsort(ids, count, sizeof(uint32_t), compare_id);
+    }
+    for (size_t i = 0; i < count; i++) {
+        StoreSegment *segment = segment_open(store, ids[i], 0);
+        if (!segment) {
+            continue;
+        }
+        if (segment_load(store, segment) < 0 || segment_add(store, segment) < 0) {
+            segment_free(segment);
+            free(ids);
+            return -1;
+        }
+        store->next_id = ids[i] + 1;
+    }
+    free(ids);
+
+    struct timespec now;
+    clock_gettime(CLOCK_REALTIME, &now);
+    drop_expired(store, now.tv_sec * 1000000000LL + now.tv_nsec);
+    return 0;
+}
+
+void image_store_close(ImageStore *store) {
+    image_store_commit(store, 0);
+    for (int i = 0; i < store->segment_count; i++) {
+        segment_seal(store->segments[i]);
+        segment_free(store->segments[i]);
+    }
+    for (size_t i = 0; i < store->robot_capacity; i++) {
+        free(store->robots[i].entries);
+    }
+    free(store->segments);
+    free(store->robots);
+    pthread_mutex_destroy(&store->lock);
+    pthread_mutex_destroy(&store->commit_lock);
+    memset(store, 0, sizeof(*store));
+}
+
+int image_store_reserve(ImageStore *store, const char *robot, int64_t timestamp, size_t length, StoreSlot *slot) {
+    if (length > UINT32_MAX || !robot[0]) {
+        return -1;
+    }
+
+    // 锁内分配位置，当前段放不下时换新段
+    pthread_mutex_lock(&store->lock);
+    StoreSegment *segment = store->segment_count ? store->segments[store->segment_count - 1] : NULL;
+    if (!segment || segment->sealed || segment->used + length > segment->capacity) {
+        if (segment) {
+            segment_seal(segment);
+        }
+        segment = segment_create(store, length > store->segment_size ? length : store->segment_size);
+        if (!segment) {
+            pthread_mutex_unlock(&store->lock);
+            return -1;
+        }
+        drop_expired(store, timestamp);
+    }
+    slot->segment = segment;
+    slot->fd = segment->data_fd;
+    slot->offset = segment->used;
+    slot->length = length;
+    segment->used += length;
+    segment->refs++;
+    pthread_mutex_unlock(&store->lock);
+    return 0;
+}
+
+int image_store_finish(ImageStore *store, const StoreSlot *slot, const char *robot, int64_t timestamp,
+                       const void *data, ssize_t written, StoreEntry *entry) {
+    // 锁外补写调用方没有写完的部分，多个写盘线程可以同时写入不同位置
+    int ret = -1;
+    if (written >= 0 && (size_t)written <= slot->length) {
+        ret = pwrite_all(slot->fd, (const char *)data + written, slot->length - written, slot->offset + written);
+    }
+
+    StoreSegment *segment = slot->segment;
+    pthread_mutex_lock(&store->lock);
+    segment->refs--;
+    StoreEntry added = { timestamp, segment->id, (uint32_t)slot->length, slot->offset };
+    if (ret == 0 && segment->pending_count == segment->pending_capacity) {
+        size_t capacity = segment->pending_capacity ? segment->pending_capacity * 2 : 64;
+        StoreRecord *pending = realloc(segment->pending, capacity * sizeof(StoreRecord));
+        if (pending) {
+            segment->pending = pending;
+            segment->pending_capacity = capacity;
+        } else {
+            ret = -1;
+        }
+    }
+    if (ret == 0 && index_insert(store, robot, &added) == 0) {
+        StoreRecord *record = &segment->pending[segment->pending_count++];
+        memset(record, 0, sizeof(*record));
+        snprintf(record->robot, sizeof(record->robot), "%s", robot);
+        record->timestamp = timestamp;
+        record->offset = slot->offset;
+        record->length = (uint32_t)slot->length;
+        record->checksum = record_checksum(record);
+        if (timestamp > segment->newest) {
+            segment->newest = timestamp;
+        }
+    } else {
+        ret = -1;
+    }
+    pthread_mutex_unlock(&store->lock);
+
+    if (ret == 0 && entry) {
+        *entry = added;
+    }
+    return ret;
+}
+
+int image_store_append(ImageStore *store, const char *robot, int64_t timestamp,
+                       const void *data, size_t length, StoreEntry *entry) {
+    StoreSlot slot;
+    if (image_store_reserve(store, robot, timestamp, length, &slot) < 0) {
+        return -1;
+    }
+    return image_store_finish(store, &slot, robot, timestamp, data, 0, entry);
+}
+
+int image_store_commit(ImageStore *store, int sync) {
+    int ret = 0;
+
+    // 同一时间只有一个线程提交。后到的线程等前一次提交完成后再检查，
+    // 它追加的记录通常已被前一次提交一并写入，直接返回（组提交）
+    pthread_mutex_lock(&store->commit_lock);
+    while (1) {
+        // 一次取出一个段的待写记录，取出后其他线程可以继续追加
+        pthread_mutex_lock(&store->lock);
+        StoreSegment *segment = NULL;
+        for (int i = 0; i < store->segment_count && !segment; i++) {
+            if (store->segments[i]->pending_count > 0) {
+                segment = store->segments[i];
+            }
+        }
+        if (!segment) {
+            pthread_mutex_unlock(&store->lock);
+            break;
+        }
+        StoreRecord *records = segment->pending;
+        size_t count = segment->pending_count;
+        segment->pending = NULL;
+        segment->pending_count = segment->pending_capacity = 0;
+        segment->refs++;
+        pthread_mutex_unlock(&store->lock);
+
+        // 数据先落盘，索引中的记录才能指向它
+        if (sync && fdatasync(segment->data_fd) < 0) {
+            perror("sync image segment failed");
+            ret = -1;
+        }
+        if (write_all(segment->index_fd, (const char *)records, count * sizeof(StoreRecord)) < 0 ||
+            (sync && fdatasync(segment->index_fd) < 0)) {
+            perror("write image index failed");
+            ret = -1;
+        }
+        free(records);
+
+        pthread_mutex_lock(&store->lock);
+        segment->refs--;
+        pthread_mutex_unlock(&store->lock);
+    }
+
+    // 新建的段文件需要目录项落盘
+    pthread_mutex_lock(&store->lock);
+    int dir_dirty = store->dir_dirty;
+    store->dir_dirty = 0;
+    pthread_mutex_unlock(&store->lock);
+    if (sync && dir_dirty) {
+        int dir_fd = open(store->dir, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+        if (dir_fd >= 0) {
+            fsync(dir_fd);
+            close(dir_fd);
+        }
+    }
+    pthread_mutex_unlock(&store->commit_lock);
+    return ret;
+}
+
+size_t image_store_query(ImageStore *store, const char *robot_name, int64_t from, int64_t to,
+                         StoreEntry *out, size_t max) {
+    size_t total = 0;
+    pthread_mutex_lock(&store->lock);
+    StoreRobot *robot = robot_find(store, robot_name, 0);
+    if (robot) {
+        size_t end = lower_bound(robot, to);
+        size_t start = lower_bound(robot, from);
+        total = end > start ? end - start : 0;
+        memcpy(out, robot->entries + start, (total < max ? total : max) * sizeof(StoreEntry));
+    }
+    pthread_mutex_unlock(&store->lock);
+    return total;
+}
+
+int image_store_read(ImageStore *store, const StoreEntry *entry, void *buffer) {
+    pthread_mutex_lock(&store->lock);
+    StoreSegment *segment = segment_find(store, entry->segment);
+    if (segment) {
+        segment->refs++;
+    }
+    pthread_mutex_unlock(&store->lock);
+    if (!segment) {
+        return -1;
+    }
+
+    int ret = pread_all(segment->data_fd, buffer, entry->length, entry->offset);
+
+    pthread_mutex_lock(&store->lock);
+    segment->refs--;
+    pthread_mutex_unlock(&store->lock);
+    return ret;
+}
+
+void image_store_stats(ImageStore *store, ImageStoreStats *stats) {
+    pthread_mutex_lock(&store->lock);
+    stats->images = store->images;
+    stats->bytes = 0;
+    for (int i = 0; i < store->segment_count; i++) {
+        stats->bytes += (long long)store->segments[i]->used;
+    }
+    stats->segments = store->segment_count;
+    stats->robots = (int)store->robot_count;
+    pthread_mutex_unlock(&store->lock);
+}
@@ -0,0 +1,95 @@
+#ifndef IMAGE_STORE_H
+#define IMAGE_STORE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <pthread.h>
+#include <sys/types.h>
+
+// 只追加的分段图像存储。图像依次追加到预分配的大段文件（segment-NNNNNNNN.dat）中，
+// 每个段有一个索引文件（segment-NNNNNNNN.idx），每张图像一条定长记录：机器人、纳秒时间戳、位置、长度。
+// 同一秒的多张图像互不覆盖，目录中只有少量大文件。
+//
+// 内存中按机器人保存按时间排序的索引，时间范围查询为 O(log n) 二分查找。
+// 保留期按整段删除：最新图像早于保留期的段连同索引文件一起删除。
+//
+// 可以由多个写盘线程并发追加：在锁内分配段内位置，锁外写入数据；
+// 索引记录在 image_store_commit 时成批写入，开启同步时先 fdatasync 数据再写索引，
+// 索引中出现的图像数据一定已经落盘。启动时丢弃索引末尾写了一半的记录。
+
+#define STORE_ROBOT_MAX 16  // 机器人标识（客户端IP）的最大长度，含结尾0
+
+typedef struct {
+    int64_t timestamp;  // 纳秒，CLOCK_REALTIME
+    uint32_t segment;   // 段号
+    uint32_t length;
+    uint64_t offset;    // 在段文件中的位置
+} StoreEntry;
+
+typedef struct StoreSegment StoreSegment;
+
+// 一个机器人的索引，entries 按时间排序
+typedef struct {
+    char robot[STORE_ROBOT_MAX];
+    StoreEntry *entries;
+    size_t count;
+    size_t capacity;
+} StoreRobot;
+
+typedef struct {
+    long long images;    // 索引中的图像数
+    long long bytes;     // 段文件中的数据量
+    int segments;
+    int robots;
+} ImageStoreStats;
+
+typedef struct {
+    pthread_mutex_t lock;
+    pthread_mutex_t commit_lock;  // 串行化 image_store_commit
+    const char *dir;
+    uint64_t segment_size;   // 新段的预分配大小，更大的图像单独占一段
+    int64_t retention_ns;    // 保留期，0表示不删除
+    StoreSegment **segments; // 按段号排序，最后一个为当前追加的段
+    int segment_count;
+    int segment_capacity;
+    uint32_t next_id;
+    int dir_dirty;           // 有新建的段文件，提交时需要 fsync 目录
+    StoreRobot *robots;      // 开放寻址哈希表，robot[0] 为0表示空位
+    size_t robot_capacity;
+    size_t robot_count;
+    long long images;
+} ImageStore;
+
+// 打开（或创建）目录中的存储，加载已有段的索引
+int image_store_open(ImageStore *store, const char *dir, uint64_t segment_size, int64_t retention_ns);
+void image_store_close(ImageStore *store);
+// 追加一张图像，数据写入段文件并加入内存索引，索引记录等到 commit 时写入；entry 可为 NULL
+int image_store_append(ImageStore *store, const char *robot, int64_t timestamp,
+                       const void *data, size_t length, StoreEntry *entry);
+
+// 段内为一张图像分配的位置
+typedef struct {
+    StoreSegment *segment;
+    int fd;           // 段文件
+    uint64_t offset;  // 数据写入的位置
+    size_t length;
+} StoreSlot;
+
+// 分两步追加，数据由调用方写入（如一批图像一次提交给 io_uring）：reserve 在段中分配位置，
+// 调用方把数据写到 slot->fd 的 slot->offset 处，然后必须调用 finish。written 为已写入的字节数，
+// 出错时为负；没写完的部分由 finish 补写。image_store_append 即 reserve 后直接 finish
+int image_store_reserve(ImageStore *store, const char *robot, int64_t timestamp, size_t length, StoreSlot *slot);
+int image_store_finish(ImageStore *store, const StoreSlot *slot, const char *robot, int64_t timestamp,
+                       const void *data, ssize_t written, StoreEntry *entry);
+// 写入已追加图像的索引记录；sync 时先 fdatasync 数据，写入索引后再 fdatasync 索引（组提交）
+int image_store_commit(ImageStore *store, int sync);
+// 查询机器人在 [from, to) 内的图像，按时间顺序写入 out（最多 max 条），返回范围内的总数
+size_t image_store_query(ImageStore *store, const char *robot, int64_t from, int64_t to,
+                         StoreEntry *out, size_t max);
+// 读取一张图像的数据到 buffer（entry->length 字节），段已被删除返回-1
+int image_store_read(ImageStore *store, const StoreEntry *entry, void *buffer);
+void image_store_stats(ImageStore *store, ImageStoreStats *stats);
+// 段文件路径，如 images/segment-00000001.dat
+void image_store_segment_path(const ImageStore *store, uint32_t id, char *path, size_t size);
+
+#endif
@@ -0,0 +1,21 @@
+#ifndef JSON_ARENA_H
+#define JSON_ARENA_H
+
+#include <stddef.h>
+
+// 每个线程一个的 cJSON 分配区。安装后，本线程 cJSON 的所有分配（解析树、打印缓冲区）
+// 都从一块连续内存中顺序分配，cJSON_Delete/cJSON_free 不做任何事；
+// 处理完一条消息后调用 json_arena_reset() 一次性回收。
+// 稳定后每条消息没有通用的 malloc/free：重置时区块按峰值用量扩大，下一条消息一块就能放下。
+//
+// 安装后 cJSON_Print 的结果要用 cJSON_free 释放，不能用 free。
+// 重置后本线程此前得到的所有 cJSON 对象和字符串都失效，只能在消息处理的最外层调用。
+
+// 为当前线程安装分配区（通过 cJSON_InitHooks，只影响本线程）
+int json_arena_install(void);
+// 回收当前线程分配区中的所有内存
+void json_arena_reset(void);
+// 线程退出前释放分配区，本线程的 cJSON 恢复使用 malloc/free
+void json_arena_release(void);
+
+#endif
@@ -0,0 +1,391 @@
+#include <stdlib.h>
+#include <string.h>
+#include "json_index.h"
+
+#define NUMBER_TEXT_MAX 64  // 需要 strtod 转换的数字的最大长度
+
+static const char *skip_whitespace(const char *p, const char *end) {
+    while (p < end && (*p == ' ' || *p == '\t' || *p == '\n' || *p == '\r')) {
+        p++;
+    }
+    return p;
+}
+
+static int hex_value(char c) {
+    if (c >= '0' && c <= '9') {
+        return c - '0';
+    }
+    if (c >= 'a' && c <= 'f') {
+        return c - 'a' + 10;
+    }
+    if (c >= 'A' && c <= 'F') {
+        return c - 'A' + 10;
+    }
+    return -1;
+}
+
+// p 指向开头的引号，返回结尾引号之后的位置，格式错误返回 NULL
+static const char *scan_string(const char *p, const char *end, int *escaped) {
+    *escaped = 0;
+    for (p++; p < end; p++) {
+        if (*p == '"') {
+            return p + 1;
+        }
+        if (*p != '\\') {
+            continue;
+        }
+        *escaped = 1;
+        if (++p >= end) {
+            return NULL;
+        }
+        if (*p == 'u') {
+            if (end - p < 5) {
+                return NULL;
+            }
+            for (int i = 1; i <= 4; i++) {
+                if (hex_value(p[i]) < 0) {
+                    return NULL;
+                }
+            }
+            p += 4;
+        } else if (!strchr("\"\\/bfnrt", *p) || *p == '\0') {
+            return NULL;
+        }
+    }
+    return NULL;
+}
+
+// 与 cJSON 接受的写法一致：整数和小数部分至少有一位数字，指数后必须有数字
+static const char *scan_number(const char *p, const char *end) {
+    int digits = 0;
+    if (p < end && *p == '-') {
+        p++;
+    }
+    for (; p < end && *p >= '0' && *p <= '9'; p++) {
+        digits++;
+    }
+    if (p < end && *p == '.') {
+        for (p++; p < end && *p >= '0' && *p <= '9'; p++) {
+            digits++;
+        }
+    }
+    if (digits == 0) {
+        return NULL;
+    }
+    if (p < end && (*p == 'e' || *p == 'E')) {
+        const char *exponent = p + 1;
+        if (exponent < end && (*exponent == '-' || *exponent == '+')) {
+            exponent++;
+        }
+        if (exponent < end && *exponent >= '0' && *exponent <= '9') {
+            for (p = exponent; p < end && *p >= '0' && *p <= '9'; p++) {
+            }
+        }
+    }
+    return p;
+}
+
+static const char *scan_literal(const char *p, const char *end, const char *literal) {
+    size_t len = strlen(literal);
+    if ((size_t)(end - p) < len || memcmp(p, literal, len) != 0) {
+        return NULL;
+    }
+    return p + len;
+}
+
+// 扫描一个值（p 已跳过前导空白），返回值之后的位置，格式错误返回 NULL
+static const char *scan_value(const char *p, const char *end, int depth, JsonValue *value) {
+    const char *start = p;
+    int escaped = 0;
+
+    if (p >= end) {
+        return NULL;
+    }
+    value->escaped = 0;
+    switch (*p) {
+        case '"':
+            p = scan_string(p, end, &escaped);
+            if (!p) {
+                return NULL;
+            }
+            value->type = JSON_INDEX_STRING;
+            value->data = start + 1;
+            value->len = (size_t)(p - start) - 2;
+            value->escaped = (uint8_t)escaped;
+            return p;
+        case 't':
+            value->type = JSON_INDEX_TRUE;
+            p = scan_literal(p, end, "true");
+            break;
+        case 'f':
+            value->type = JSON_INDEX_FALSE;
+            p = scan_literal(p, end, "false");
+            break;
+        case 'n':
+            value->type = JSON_INDEX_NULL;
+            p = scan_literal(p, end, "null");
+            break;
+        case '{':
+        case '[': {
+            char close = *p == '{' ? '}' : ']';
+            JsonValue member;
+            if (depth >= JSON_INDEX_MAX_DEPTH) {
+                return NULL;
+            }
+            value->type = *p == '{' ? JSON_INDEX_OBJECT : JSON_INDEX_ARRAY;
+            p = skip_whitespace(p + 1, end);
+            if (p < end && *p == close) {
+                p++;
+                break;
+            }
+            while (p) {
+                if (close == '}') {
+                    if (p >= end || *p != '"' || !(p = scan_string(p, end, &escaped))) {
+                        return NULL;
+                    }
+                    p = skip_whitespace(p, end);
+                    if (p >= end || *p != ':') {
+                        return NULL;
+                    }
+                    p = skip_whitespace(p + 1, end);
+                }
+                p = scan_value(p, end, depth + 1, &member);
+                if (!p) {
+                    return NULL;
+                }
+                p = skip_whitespace(p, end);
+                if (p < end && *p == ',') {
+                    p = skip_whitespace(p + 1, end);
+                } else if (p < end && *p == close) {
+                    p++;
+                    break;
+                } else {
+                    return NULL;
+                }
+            }
+            break;
+        }
+        default:
+            // 与 cJSON 一样，数字值只能以负号或数字开头
+            if (*p != '-' && (*p < '0' || *p > '9')) {
+                return NULL;
+            }
+            value->type = JSON_INDEX_NUMBER;
+            p = scan_number(p, end);
+            break;
+    }
+    if (!p) {
+        return NULL;
+    }
+    value->data = start;
+    value->len = (size_t)(p - start);
+    return p;
+}
+
+int json_index_build(JsonIndex *index, const char *json, size_t len) {
+    const char *end = json + len;
+    const char *p = skip_whitespace(json, end);
+    int escaped = 0;
+
+    index->count = 0;
+    if (p >= end || *p != '{') {
+        return -1;
+    }
+    p = skip_whitespace(p + 1, end);
+    if (p >= end || *p != '}') {
+        for (;;) {
+            if (index->count == JSON_INDEX_MAX_FIELDS) {
+                return -1;
+            }
+            JsonField *field = &index->fields[index->count];
+            const char *key = p;
+            if (p >= end || *p != '"' || !(p = scan_string(p, end, &escaped))) {
+                return -1;
+            }
+            field->key = key + 1;
+            field->key_len = (size_t)(p - key) - 2;
+            p = skip_whitespace(p, end);
+            if (p >= end || *p != ':') {
+                return -1;
+            }
+            p = scan_value(skip_whitespace(p + 1, end), end, 1, &field->value);
+            if (!p) {
+                return -1;
+            }
+            index->count++;
+            p = skip_whitespace(p, end);
+            if (p < end && *p == ',') {
+                p = skip_whitespace(p + 1, end);
+            } else if (p < end && *p == '}') {
+                break;
+            } else {
+                return -1;
+            }
+        }
+    }
+    // 与 cJSON_ParseWithLength 一样，不检查对象之后的内容
+    return 0;
+}
+
+const JsonValue *json_index_get(const JsonIndex *index, const char *key) {
+    size_t key_len = strlen(key);
+    for (int i = 0; i < index->count; i++) {
+        const JsonField *field = &index->fields[i];
+        if (field->key_len == key_len && memcmp(field->key, key, key_len) == 0) {
+            return &field->value;
+        }
+    }
+    return NULL;
+}
+
+int json_value_equals(const JsonValue *value, const char *text) {
+    if (!value || value->type != JSON_INDEX_STRING) {
+        return 0;
+    }
+    if (!value->escaped) {
+        return value->len == strlen(text) && memcmp(value->data, text, value->len) == 0;
+    }
+
+    // 解码后的长度不超过原始内容
+    char decoded[256];
+    if (value->len >= sizeof(decoded)) {
+        return 0;
+    }
+    return json_value_string(value, decoded, sizeof(decoded)) >= 0 && strcmp(decoded, text) == 0;
+}
+
+static unsigned read_hex4(const char *p) {
+    return (unsigned)(hex_value(p[0]) << 12 | hex_value(p[1]) << 8 | hex_value(p[2]) << 4 | hex_value(p[3]));
+}
+
+int json_value_string(const JsonValue *value, char *out, size_t out_size) {
+    if (!value || value->type != JSON_INDEX_STRING || out_size == 0) {
+        return -1;
+    }
+    if (!value->escaped) {
+        if (value->len >= out_size) {
+            return -1;
+        }
+        memcpy(out, value->data, value->len);
+        out[value->len] = '\0';
+        return (int)value->len;
+    }
+
+    const char *p = value->data;
+    const char *end = value->data + value->len;
+    size_t pos = 0;
+    while (p < end) {
+        char utf8[4];
+        size_t utf8_len = 1;
+        if (*p != '\\') {
+            utf8[0] = *p++;
+        } else {
+            // build 时已校验过转义序列
+            p++;
+            switch (*p) {
+                case 'b': utf8[0] = '\b'; break;
+                case 'f': utf8[0] = '\f'; break;
+                case 'n': utf8[0] = '\n'; break;
+                case 'r': utf8[0] = '\r'; break;
+                case 't': utf8[0] = '\t'; break;
+                case 'u': {
+                    unsigned code = read_hex4(p + 1);
+                    p += 4;
+                    // 代理对
+                    if (code >= 0xD800 && code <= 0xDBFF && end - p >= 7 && p[1] == '\\' && p[2] == 'u') {
+                        unsigned low = read_hex4(p + 3);
+                        if (low >= 0xDC00 && low <= 0xDFFF) {
+                            code = 0x10000 + ((code - 0xD800) << 10) + (low - 0xDC00);
+                            p += 6;
+                        }
+                    }
+                    if (code >= 0xD800 && code <= 0xDFFF) {
+                        return -1;  // 不成对的代理
+                    }
+                    if (code < 0x80) {
+                        utf8[0] = (char)code;
+                    } else if (code < 0x800) {
+                        utf8[0] = (char)(0xC0 | (code >> 6));
+                        utf8[1] = (char)(0x80 | (code & 0x3F));
+                        utf8_len = 2;
+                    } else if (code < 0x10000) {
+                        utf8[0] = (char)(0xE0 | (code >> 12));
+                        utf8[1] = (char)(0x80 | ((code >> 6) & 0x3F));
+                        utf8[2] = (char)(0x80 | (code & 0x3F));
+                        utf8_len = 3;
+                    } else {
+                        utf8[0] = (char)(0xF0 | (code >> 18));
+                        utf8[1] = (char)(0x80 | ((code >> 12) & 0x3F));
+                        utf8[2] = (char)(0x80 | ((code >> 6) & 0x3F));
+                        utf8[3] = (char)(0x80 | (code & 0x3F));
+                        utf8_len = 4;
+                    }
+                    break;
+                }
+                default: utf8[0] = *p; break;  // \" \\ \/
+            }
+            p++;
+        }
+        if (pos + utf8_len >= out_size) {
+            return -1;
+        }
+        memcpy(out + pos, utf8, utf8_len);
+        pos += utf8_len;
+    }
+    out[pos] = '\0';
+    return (int)pos;
+}
+
+int json_value_number(const JsonValue *value, double *number) {
+    if (!value || value->type != JSON_INDEX_NUMBER) {
+        return -1;
+    }
+
+    // 时间戳、时长等整数直接累加
+    const char *p = value->data;
+    const char *end = value->data + value->len;
+    int negative = *p == '-';
+    if (*p == '-' || *p == '+') {
+        p++;
+    }
+    if (end - p <= 18) {
+        int64_t integer = 0;
+        const char *digit = p;
+        while (digit < end && *digit >= '0' && *digit <= '9') {
+            integer = integer * 10 + (*digit++ - '0');
+        }
+        if (digit == end) {
+            *number = negative ? -(double)integer : (double)integer;
+            return 0;
+        }
+    }
+
+    // 小数和指数交给 strtod
+    char text[NUMBER_TEXT_MAX];
+    if (value->len >= sizeof(text)) {
+        return -1;
+    }
+    memcpy(text, value->data, value->len);
+    text[value->len] = '\0';
+    *number = strtod(text, NULL);
+    return 0;
+}
+
+int json_array_next(const JsonValue *array, size_t *cursor, JsonValue *element) {
+    if (!array || array->type != JSON_INDEX_ARRAY) {
+        return 0;
+    }
+    // 跳过 '[' 或上一个元素后的 ','；build 时已校验过整个数组
+    const char *end = array->data + array->len;
+    const char *p = skip_whitespace(array->data + *cursor + 1, end);
+    if (p >= end || *p == ']') {
+        *cursor = array->len;
+        return 0;
+    }
+    p = scan_value(p, end, 1, element);
+    if (!p) {
+        return 0;
+    }
+    *cursor = (size_t)(skip_whitespace(p, end) - array->data);
+    return 1;
+}
@@ -0,0 +1,370 @@
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include "reactor.h"
+
+#ifdef __linux__
+#include <sys/epoll.h>
+#include "reactor_uring.h"
+
+struct Reactor {
+    int epfd;
+#ifdef USE_IO_URING
+    UringReactor *uring;  // 非空时所有操作走 io_uring
+#endif
+};
+
+Reactor *reactor_create(void) {
+    Reactor *reactor = calloc(1, sizeof(Reactor));
+    if (!reactor) {
+        return NULL;
+    }
+#ifdef USE_IO_URING
+    reactor->uring = uring_reactor_create();
+    if (reactor->uring) {
+        reactor->epfd = -1;
+        return reactor;
+    }
+#endif
+    reactor->epfd = epoll_create1(EPOLL_CLOEXEC);
+    if (reactor->epfd < 0) {
+        free(reactor);
+        return NULL;
+    }
+    return reactor;
+}
+
+void reactor_destroy(Reactor *reactor) {
+    if (reactor) {
+#ifdef USE_IO_URING
+        uring_reactor_destroy(reactor->uring);
+#endif
+        if (reactor->epfd >= 0) {
+            close(reactor->epfd);
+        }
+        free(reactor);
+    }
+}
+
+const char *reactor_backend(Reactor *reactor) {
+#ifdef USE_IO_URING
+    if (reactor->uring) {
+        return "io_uring";
+    }
+#else
+    (void)reactor;
+#endif
+    return "epoll";
+}
+
+static int reactor_ctl(Reactor *reactor, int op, int fd, int events, uint64_t data) {
+    struct epoll_event ev;
+    memset(&ev, 0, sizeof(ev));
+    ev.events = EPOLLET | EPOLLRDHUP;
+    if (events & REACTOR_READ) {
+        ev.events |= EPOLLIN;
+    }
+    if (events & REACTOR_WRITE) {
+        ev.events |= EPOLLOUT;
+    }
+    ev.data.u64 = data;
+    return epoll_ctl(reactor->epfd, op, fd, &ev);
+}
+
+int reactor_add(Reactor *reactor, int fd, int events, uint64_t data) {
+#ifdef USE_IO_URING
+    if (reactor->uring) {
+        return uring_reactor_add(reactor->uring, fd, events, data);
+    }
+#endif
+    return reactor_ctl(reactor, EPOLL_CTL_ADD, fd, events, data);
+}
+
+int reactor_mod(Reactor *reactor, int fd, int events, uint64_t data) {
+#ifdef USE_IO_URING
+    if (reactor->uring) {
+        return uring_reactor_mod(reactor->uring, fd, events, data);
+    }
+#endif
+    return reactor_ctl(reactor, EPOLL_CTL_MOD, fd, events, data);
+}
+
+int reactor_del(Reactor *reactor, int fd) {
+#ifdef USE_IO_URING
+    if (reactor->uring) {
+        return uring_reactor_del(reactor->uring, fd);
+    }
+#endif
+    return epoll_ctl(reactor->epfd, EPOLL_CTL_DEL, fd, NULL);
+}
+
+int reactor_completions(Reactor *reactor) {
+#ifdef USE_IO_URING
+    if (reactor->uring) {
+        return uring_reactor_completions(reactor->uring);
+    }
+#else
+    (void)reactor;
+#endif
+    return 0;
+}
+
+int reactor_accept(Reactor *reactor, int fd, uint64_t data) {
+#ifdef USE_IO_URING
+    if (reactor->uring) {
+        return uring_reactor_accept(reactor->uring, fd, data);
+    }
+#else
+    (void)reactor; (void)fd; (void)data;
+#endif
+    errno = ENOSYS;
+    return -1;
+}
+
+int reactor_recv(Reactor *reactor, int fd, void *buffer, size_t len, uint64_t data) {
+#ifdef USE_IO_URING
+    if (reactor->uring) {
+        return uring_reactor_recv(reactor->uring, fd, buffer, len, data);
+    }
+#else
+    (void)reactor; (void)fd; (void)buffer; (void)len; (void)data;
+#endif
+    errno = ENOSYS;
+    return -1;
+}
+
+int reactor_sendmsg(Reactor *reactor, int fd, const struct msghdr *msg, uint64_t data) {
+#ifdef USE_IO_URING
+    if (reactor->uring) {
+        return uring_reactor_sendmsg(reactor->uring, fd, msg, data);
+    }
+#else
+    (void)reactor; (void)fd; (void)msg; (void)data;
+#endif
+    errno = ENOSYS;
+    return -1;
+}
+
+void reactor_recycle(Reactor *reactor, const ReactorEvent *event) {
+#ifdef USE_IO_URING
+    if (reactor->uring) {
+        uring_reactor_recycle(reactor->uring, event);
+    }
+#else
+    (void)reactor; (void)event;
+#endif
+}
+
+int reactor_cancel(Reactor *reactor, int fd) {
+#ifdef USE_IO_URING
+    if (reactor->uring) {
+        return uring_reactor_cancel(reactor->uring, fd);
+    }
+#else
+    (void)reactor; (void)fd;
+#endif
+    errno = ENOSYS;
+    return -1;
+}
+
+int reactor_wait(Reactor *reactor, ReactorEvent *events, int max_events, int timeout_ms) {
+#ifdef USE_IO_URING
+    if (reactor->uring) {
+        return uring_reactor_wait(reactor->uring, events, max_events, timeout_ms);
+    }
+#endif
+    struct epoll_event ep_events[64];
+    if (max_events > 64) {
+        max_events = 64;
+    }
+
+    int n = epoll_wait(reactor->epfd, ep_events, max_events, timeout_ms);
+    if (n < 0) {
+        return errno == EINTR ? 0 : -1;
+    }
+
+    for (int i = 0; i < n; i++) {
+        events[i].data = ep_events[i].data.u64;
+        events[i].buffer = NULL;
+        events[i].events = 0;
+        if (ep_events[i].events & EPOLLIN) {
+            events[i].events |= REACTOR_READ;
+        }
+        if (ep_events[i].events & EPOLLOUT) {
+            events[i].events |= REACTOR_WRITE;
+        }
+        if (ep_events[i].events & (EPOLLHUP | EPOLLERR | EPOLLRDHUP)) {
+            // 对端关闭时仍需读出剩余数据，交给调用方通过 recv()==0 判断
+            events[i].events |= REACTOR_HUP | REACTOR_READ;
+        }
+    }
+    return n;
+}
+
+#else /* !__linux__ */
+#include <poll.h>
+
+struct Reactor {
+    struct pollfd *fds;
+    uint64_t *data;
+    int count;
+    int capacity;
+};
+
+Reactor *reactor_create(void) {
+    Reactor *reactor = calloc(1, sizeof(Reactor));
+    return reactor;
+}
+
+void reactor_destroy(Reactor *reactor) {
+    if (reactor) {
+        free(reactor->fds);
+        free(reactor->data);
+        free(reactor);
+    }
+}
+
+const char *reactor_backend(Reactor *reactor) {
+    (void)reactor;
+    return "poll";
+}
+
+static short poll_events(int events) {
+    short pev = 0;
+    if (events & REACTOR_READ) {
+        pev |= POLLIN;
+    }
+    if (events & REACTOR_WRITE) {
+        pev |= POLLOUT;
+    }
+    return pev;
+}
+
+static int reactor_find(Reactor *reactor, int fd) {
+    for (int i = 0; i < reactor->count; i++) {
+        if (reactor->fds[i].fd == fd) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+int reactor_add(Reactor *reactor, int fd, int events, uint64_t data) {
+    if (reactor->count == reactor->capacity) {
+        int capacity = reactor->capacity ? reactor->capacity * 2 : 16;
+        struct pollfd *fds = realloc(reactor->fds, capacity * sizeof(struct pollfd));
+        if (!fds) {
+            return -1;
+        }
+        reactor->fds = fds;
+        uint64_t *data_array = realloc(reactor->data, capacity * sizeof(uint64_t));
+        if (!data_array) {
+            return -1;
+        }
+        reactor->data = data_array;
+        reactor->capacity = capacity;
+    }
+    reactor->fds[reactor->count].fd = fd;
+    reactor->fds[reactor->count].events = poll_events(events);
+    reactor->fds[reactor->count].revents = 0;
+    reactor->data[reactor->count] = data;
+    reactor->count++;
+    return 0;
+}
+
+int reactor_mod(Reactor *reactor, int fd, int events, uint64_t data) {
+    int i = reactor_find(reactor, fd);
+    if (i < 0) {
+        errno = ENOENT;
+        return -1;
+    }
+    reactor->fds[i].events = poll_events(events);
+    reactor->data[i] = data;
+    return 0;
+}
+
+int reactor_del(Reactor *reactor, int fd) {
+    int i = reactor_find(reactor, fd);
+    if (i < 0) {
+        errno = ENOENT;
+        return -1;
+    }
+    reactor->count--;
+    reactor->fds[i] = reactor->fds[reactor->count];
+    reactor->data[i] = reactor->data[reactor->count];
+    return 0;
+}
+
+int reactor_wait(Reactor *reactor, ReactorEvent *events, int max_events, int timeout_ms) {
+    int n = poll(reactor->fds, reactor->count, timeout_ms);
+    if (n < 0) {
+        return errno == EINTR ? 0 : -1;
+    }
+
+    int ready = 0;
+    for (int i = 0; i < reactor->count && ready < max_events; i++) {
+        short rev = reactor->fds[i].revents;
+        if (!rev) {
+            continue;
+        }
+        events[ready].data = reactor->data[i];
+        events[ready].buffer = NULL;
+        events[ready].events = 0;
+        if (rev & POLLIN) {
+            events[ready].events |= REACTOR_READ;
+        }
+        if (rev & POLLOUT) {
+            events[ready].events |= REACTOR_WRITE;
+        }
+        if (rev & (POLLHUP | POLLERR)) {
+            events[ready].events |= REACTOR_HUP | REACTOR_READ;
+        }
+        ready++;
+    }
+    return ready;
+}
+
+int reactor_completions(Reactor *reactor) {
+    (void)reactor;
+    return 0;
+}
+
+int reactor_accept(Reactor *reactor, int fd, uint64_t data) {
+    (void)reactor; (void)fd; (void)data;
+    errno = ENOSYS;
+    return -1;
+}
+
+int reactor_recv(Reactor *reactor, int fd, void *buffer, size_t len, uint64_t data) {
+    (void)reactor; (void)fd; (void)buffer; (void)len; (void)data;
+    errno = ENOSYS;
+    return -1;
+}
+
+int reactor_sendmsg(Reactor *reactor, int fd, const struct msghdr *msg, uint64_t data) {
+    (void)reactor; (void)fd; (void)msg; (void)data;
+    errno = ENOSYS;
+    return -1;
+}
+
+void reactor_recycle(Reactor *reactor, const ReactorEvent *event) {
+    (void)reactor; (void)event;
+}
+
+int reactor_cancel(Reactor *reactor, int fd) {
+    (void)reactor; (void)fd;
+    errno = ENOSYS;
+    return -1;
+}
+
+#endif
+
+int set_socket_nonblocking(int fd) {
+    int flags = fcntl(fd, F_GETFL, 0);
+    if (flags < 0) {
+        return -1;
+    }
+    return fcntl(fd, F_SETFL, flags | O_NONBLOCK);
+}
@@ -0,0 +1,60 @@
+#ifndef REACTOR_H
+#define REACTOR_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+
+// 事件类型
+#define REACTOR_READ  0x01
+#define REACTOR_WRITE 0x02
+#define REACTOR_HUP   0x04
+// 完成事件，只在 reactor_completions() 非0时出现，每个事件对应一次提交
+#define REACTOR_ACCEPTED 0x08
+#define REACTOR_RECEIVED 0x10
+#define REACTOR_SENT     0x20
+
+typedef struct {
+    int events;
+    uint64_t data;  // 注册或提交时传入的标识
+    // 以下只对完成事件有效
+    int result;     // 新连接的 fd 或收发的字节数，出错为 -errno
+    char *buffer;   // 从接收缓冲区池取得的数据，非空时处理完必须 reactor_recycle()
+    int buffer_id;
+    struct sockaddr_in peer;  // 新连接的对端地址
+} ReactorEvent;
+
+typedef struct Reactor Reactor;
+
+// Linux 下使用边沿触发的 epoll，其他平台退回到 poll()。
+// 以 -DUSE_IO_URING 编译时优先使用 io_uring，内核不支持时退回 epoll。
+// 所有后端下调用方都必须把 fd 读/写到 EAGAIN 为止。
+Reactor *reactor_create(void);
+void reactor_destroy(Reactor *reactor);
+// 当前使用的后端名称
+const char *reactor_backend(Reactor *reactor);
+int reactor_add(Reactor *reactor, int fd, int events, uint64_t data);
+int reactor_mod(Reactor *reactor, int fd, int events, uint64_t data);
+int reactor_del(Reactor *reactor, int fd);
+// 返回就绪事件数，超时返回0，出错返回-1
+int reactor_wait(Reactor *reactor, ReactorEvent *events, int max_events, int timeout_ms);
+
+// 完成式 I/O：accept/recv/sendmsg 由内核执行，结果在 reactor_wait() 中以完成事件返回，
+// 提交与等待合并为一次系统调用。只有 io_uring 后端且内核支持接收缓冲区池（5.19+）时可用，
+// 此时 fd 保持阻塞模式；其他后端返回0，下列函数失败并置 errno 为 ENOSYS。
+int reactor_completions(Reactor *reactor);
+int reactor_accept(Reactor *reactor, int fd, uint64_t data);
+// buffer 为 NULL 时在数据到达后从接收缓冲区池取缓冲区
+int reactor_recv(Reactor *reactor, int fd, void *buffer, size_t len, uint64_t data);
+// msg 及其引用的数据在完成事件返回前必须保持有效
+int reactor_sendmsg(Reactor *reactor, int fd, const struct msghdr *msg, uint64_t data);
+// 把完成事件的接收缓冲区还给池
+void reactor_recycle(Reactor *reactor, const ReactorEvent *event);
+// 取消 fd 上所有在途的请求，被取消的请求仍会返回完成事件（result 为 -ECANCELED）
+int reactor_cancel(Reactor *reactor, int fd);
+
+// 把套接字设置为非阻塞
+int set_socket_nonblocking(int fd);
+
+#endif
@@ -0,0 +1,672 @@
+#if defined(__linux__) && defined(USE_IO_URING)
+#define _GNU_SOURCE  // POLLRDHUP
+
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <poll.h>
+#include <time.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <linux/io_uring.h>
+#include "reactor_uring.h"
+
+#define URING_ENTRIES 256
+#define URING_CQ_ENTRIES 4096  // 每个连接都可能有在途的接收和发送，完成队列比提交队列大得多
+#define URING_INTERNAL ((uint64_t)-1)  // 修改/删除/取消请求自身的完成事件，忽略
+#define URING_OP_FLAG ((uint64_t)1 << 32)  // 完成式请求的 user_data 为此位加请求下标，poll 请求的为 fd
+#define URING_BUFFERS 1024  // 接收缓冲区池的缓冲区数，2的幂
+#define URING_BUFFER_SIZE 4096  // 只装消息和图像开头的数据，图像的其余部分直接收进写盘缓冲区
+#define URING_BUFFER_GROUP 0
+#define URING_ACCEPT_MAX 16  // 同时在途的 accept 请求上限
+#define URING_WRITER_ENTRIES 32
+
+// 提交队列和完成队列，由事件循环和写盘线程共用
+typedef struct {
+    int fd;
+    void *sq_ring;
+    size_t ring_size;
+    struct io_uring_sqe *sqes;
+    size_t sqes_size;
+
+    unsigned *sq_head;
+    unsigned *sq_tail;
+    unsigned *sq_mask;
+    unsigned *sq_array;
+    unsigned sq_entries;
+    unsigned to_submit;
+
+    unsigned *cq_head;
+    unsigned *cq_tail;
+    unsigned *cq_mask;
+    struct io_uring_cqe *cqes;
+} UringRing;
+
+// 已注册的 fd，下标即 fd，poll 请求的 user_data 也是 fd
+typedef struct {
+    uint64_t data;
+    int events;
+    int armed;
+} UringFd;
+
+// 在途的完成式请求
+typedef struct {
+    int kind;    // REACTOR_ACCEPTED/RECEIVED/SENT，0 为空闲
+    int accept;  // accept 请求使用的 accepts 下标
+    uint64_t data;
+    int next_free;
+} UringOp;
+
+// accept 请求的对端地址，内核在完成时写入，不能随请求表移动
+typedef struct {
+    struct sockaddr_in addr;
+    socklen_t len;
+    int busy;
+} UringAccept;
+
+struct UringReactor {
+    UringRing ring;
+    UringFd *fds;
+    int fd_capacity;
+
+    UringOp *ops;
+    int op_capacity;
+    int op_free;
+    int op_pending;
+    UringAccept accepts[URING_ACCEPT_MAX];
+
+    // 接收缓冲区池：数据到达时内核从中选一个，空闲连接不占用接收缓冲区
+    struct io_uring_buf_ring *buf_ring;
+    size_t buf_ring_size;
+    char *buffers;
+    unsigned short buf_tail;
+    int completions;  // 缓冲区池注册成功，支持完成式 I/O
+};
+
+struct UringWriter {
+    UringRing ring;
+};
+
+static int sys_io_uring_setup(unsigned entries, struct io_uring_params *params) {
+    return (int)syscall(__NR_io_uring_setup, entries, params);
+}
+
+static int sys_io_uring_enter(int fd, unsigned to_submit, unsigned min_complete,
+                              unsigned flags, void *arg, size_t argsz) {
+    return (int)syscall(__NR_io_uring_enter, fd, to_submit, min_complete, flags, arg, argsz);
+}
+
+static int sys_io_uring_register(int fd, unsigned opcode, void *arg, unsigned nr_args) {
+    return (int)syscall(__NR_io_uring_register, fd, opcode, arg, nr_args);
+}
+
+static int ring_init(UringRing *ring, unsigned entries, unsigned cq_entries) {
+    struct io_uring_params params;
+    memset(&params, 0, sizeof(params));
+    params.flags = IORING_SETUP_CQSIZE;
+    params.cq_entries = cq_entries;
+
+    int ring_fd = sys_io_uring_setup(entries, &params);
+    if (ring_fd < 0) {
+        return -1;
+    }
+    // 需要单次 mmap 和带超时的等待（Linux 5.11+）
+    if (!(params.features & IORING_FEAT_SINGLE_MMAP) || !(params.features & IORING_FEAT_EXT_ARG)) {
+        close(ring_fd);
+        errno = ENOSYS;
+        return -1;
+    }
+    ring->fd = ring_fd;
+
+    size_t sq_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    size_t cq_size = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+    ring->ring_size = sq_size > cq_size ? sq_size : cq_size;
+    ring->sq_ring = mmap(NULL, ring->ring_size, PROT_READ | PROT_WRITE,
+                         MAP_SHARED | MAP_POPULATE, ring_fd, IORING_OFF_SQ_RING);
+    if (ring->sq_ring == MAP_FAILED) {
+        close(ring_fd);
+        return -1;
+    }
+
+    ring->sqes_size = params.sq_entries * sizeof(struct io_uring_sqe);
+    ring->sqes = mmap(NULL, ring->sqes_size, PROT_READ | PROT_WRITE,
+                      MAP_SHARED | MAP_POPULATE, ring_fd, IORING_OFF_SQES);
+    if (ring->sqes == MAP_FAILED) {
+        munmap(ring->sq_ring, ring->ring_size);
+        close(ring_fd);
+        return -1;
+    }
+
+    char *sq = ring->sq_ring;
+    ring->sq_head = (unsigned *)(sq + params.sq_off.head);
+    ring->sq_tail = (unsigned *)(sq + params.sq_off.tail);
+    ring->sq_mask = (unsigned *)(sq + params.sq_off.ring_mask);
+    ring->sq_array = (unsigned *)(sq + params.sq_off.array);
+    ring->sq_entries = params.sq_entries;
+    ring->to_submit = 0;
+
+    char *cq = ring->sq_ring;
+    ring->cq_head = (unsigned *)(cq + params.cq_off.head);
+    ring->cq_tail = (unsigned *)(cq + params.cq_off.tail);
+    ring->cq_mask = (unsigned *)(cq + params.cq_off.ring_mask);
+    ring->cqes = (struct io_uring_cqe *)(cq + params.cq_off.cqes);
+    return 0;
+}
+
+static void ring_free(UringRing *ring) {
+    munmap(ring->sqes, ring->sqes_size);
+    munmap(ring->sq_ring, ring->ring_size);
+    close(ring->fd);
+}
+
+// 提交所有排队的请求，不等待完成
+static int ring_submit(UringRing *ring) {
+    while (ring->to_submit > 0) {
+        int n = sys_io_uring_enter(ring->fd, ring->to_submit, 0, 0, NULL, 0);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return -1;
+        }
+        ring->to_submit -= n;
+    }
+    return 0;
+}
+
+static struct io_uring_sqe *ring_get_sqe(UringRing *ring) {
+    unsigned tail = *ring->sq_tail;
+    unsigned head = __atomic_load_n(ring->sq_head, __ATOMIC_ACQUIRE);
+    if (tail - head >= ring->sq_entries) {
+        // 提交队列已满，先提交一批
+        if (ring_submit(ring) < 0) {
+            return NULL;
+        }
+    }
+
+    unsigned index = tail & *ring->sq_mask;
+    struct io_uring_sqe *sqe = &ring->sqes[index];
+    memset(sqe, 0, sizeof(*sqe));
+    ring->sq_array[index] = index;
+    __atomic_store_n(ring->sq_tail, tail + 1, __ATOMIC_RELEASE);
+    ring->to_submit++;
+    return sqe;
+}
+
+// 把缓冲区放回池中
+static void buffer_add(UringReactor *uring, int id) {
+    struct io_uring_buf *buf = &uring->buf_ring->bufs[uring->buf_tail & (URING_BUFFERS - 1)];
+    buf->addr = (uint64_t)(uintptr_t)(uring->buffers + (size_t)id * URING_BUFFER_SIZE);
+    buf->len = URING_BUFFER_SIZE;
+    buf->bid = (uint16_t)id;
+    uring->buf_tail++;
+    __atomic_store_n(&uring->buf_ring->tail, uring->buf_tail, __ATOMIC_RELEASE);
+}
+
+// 注册接收缓冲区池（Linux 5.19+），失败时只支持就绪通知
+static int buffers_init(UringReactor *uring) {
+    uring->buf_ring_size = URING_BUFFERS * sizeof(struct io_uring_buf);
+    uring->buf_ring = mmap(NULL, uring->buf_ring_size, PROT_READ | PROT_WRITE,
+                           MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (uring->buf_ring == MAP_FAILED) {
+        uring->buf_ring = NULL;
+        return -1;
+    }
+    uring->buffers = malloc((size_t)URING_BUFFERS * URING_BUFFER_SIZE);
+    if (!uring->buffers) {
+        return -1;
+    }
+
+    struct io_uring_buf_reg reg;
+    memset(&reg, 0, sizeof(reg));
+    reg.ring_addr = (uint64_t)(uintptr_t)uring->buf_ring;
+    reg.ring_entries = URING_BUFFERS;
+    reg.bgid = URING_BUFFER_GROUP;
+    if (sys_io_uring_register(uring->ring.fd, IORING_REGISTER_PBUF_RING, &reg, 1) < 0) {
+        return -1;
+    }
+    for (int i = 0; i < URING_BUFFERS; i++) {
+        buffer_add(uring, i);
+    }
+    return 0;
+}
+
+UringReactor *uring_reactor_create(void) {
+    UringReactor *uring = calloc(1, sizeof(UringReactor));
+    if (!uring) {
+        return NULL;
+    }
+    if (ring_init(&uring->ring, URING_ENTRIES, URING_CQ_ENTRIES) < 0) {
+        free(uring);
+        return NULL;
+    }
+    uring->op_free = -1;
+    uring->completions = buffers_init(uring) == 0;
+    return uring;
+}
+
+// 撤销所有在途请求并等它们完成。关闭 ring 后内核在后台异步清理，
+// 在途的 accept 会让监听 socket 多存活一段时间，新进程用 SO_REUSEPORT 监听同一端口时
+// 一部分连接会被分到这个即将关闭的 socket 上而被重置
+static void uring_reactor_drain(UringReactor *uring) {
+    if (uring->op_pending == 0) {
+        return;
+    }
+    struct io_uring_sqe *sqe = ring_get_sqe(&uring->ring);
+    if (!sqe) {
+        return;
+    }
+    sqe->opcode = IORING_OP_ASYNC_CANCEL;
+    sqe->fd = -1;
+    sqe->cancel_flags = IORING_ASYNC_CANCEL_ANY | IORING_ASYNC_CANCEL_ALL;
+    sqe->user_data = URING_INTERNAL;
+
+    ReactorEvent events[64];
+    for (int i = 0; i < 100 && uring->op_pending > 0; i++) {
+        if (uring_reactor_wait(uring, events, 64, 10) < 0) {
+            break;
+        }
+    }
+}
+
+void uring_reactor_destroy(UringReactor *uring) {
+    if (!uring) {
+        return;
+    }
+    uring_reactor_drain(uring);
+    ring_free(&uring->ring);
+    if (uring->buf_ring) {
+        munmap(uring->buf_ring, uring->buf_ring_size);
+    }
+    free(uring->buffers);
+    free(uring->fds);
+    free(uring->ops);
+    free(uring);
+}
+
+int uring_reactor_completions(UringReactor *uring) {
+    return uring->completions;
+}
+
+static unsigned poll_mask(int events) {
+    unsigned mask = POLLRDHUP;
+    if (events & REACTOR_READ) {
+        mask |= POLLIN;
+    }
+    if (events & REACTOR_WRITE) {
+        mask |= POLLOUT;
+    }
+    return mask;
+}
+
+// 为 fd 提交一个多次触发的 poll 请求
+static int uring_arm(UringReactor *uring, int fd) {
+    struct io_uring_sqe *sqe = ring_get_sqe(&uring->ring);
+    if (!sqe) {
+        return -1;
+    }
+    sqe->opcode = IORING_OP_POLL_ADD;
+    sqe->fd = fd;
+    sqe->poll32_events = poll_mask(uring->fds[fd].events);
+    sqe->len = IORING_POLL_ADD_MULTI;
+    sqe->user_data = (uint64_t)fd;
+    uring->fds[fd].armed = 1;
+    return 0;
+}
+
+int uring_reactor_add(UringReactor *uring, int fd, int events, uint64_t data) {
+    if (fd >= uring->fd_capacity) {
+        int capacity = uring->fd_capacity ? uring->fd_capacity : 64;
+        while (capacity <= fd) {
+            capacity *= 2;
+        }
+        UringFd *fds = realloc(uring->fds, capacity * sizeof(UringFd));
+        if (!fds) {
+            return -1;
+        }
+        memset(fds + uring->fd_capacity, 0, (capacity - uring->fd_capacity) * sizeof(UringFd));
+        uring->fds = fds;
+        uring->fd_capacity = capacity;
+    }
+    uring->fds[fd].data = data;
+    uring->fds[fd].events = events;
+    return uring_arm(uring, fd);
+}
+
+int uring_reactor_mod(UringReactor *uring, int fd, int events, uint64_t data) {
+    if (fd >= uring->fd_capacity || !uring->fds[fd].armed) {
+        errno = ENOENT;
+        return -1;
+    }
+    uring->fds[fd].data = data;
+    if (uring->fds[fd].events == events) {
+        return 0;
+    }
+    uring->fds[fd].events = events;
+
+    // 原地更新已有 poll 请求的事件掩码
+    struct io_uring_sqe *sqe = ring_get_sqe(&uring->ring);
+    if (!sqe) {
+        return -1;
+    }
+    sqe->opcode = IORING_OP_POLL_REMOVE;
+    sqe->fd = -1;
+    sqe->addr = (uint64_t)fd;
+    sqe->poll32_events = poll_mask(events);
+    sqe->len = IORING_POLL_UPDATE_EVENTS | IORING_POLL_ADD_MULTI;
+    sqe->user_data = URING_INTERNAL;
+    return 0;
+}
+
+int uring_reactor_del(UringReactor *uring, int fd) {
+    if (fd >= uring->fd_capacity || !uring->fds[fd].armed) {
+        errno = ENOENT;
+        return -1;
+    }
+    uring->fds[fd].armed = 0;
+
+    struct io_uring_sqe *sqe = ring_get_sqe(&uring->ring);
+    if (!sqe) {
+        return -1;
+    }
+    sqe->opcode = IORING_OP_POLL_REMOVE;
+    sqe->fd = -1;
+    sqe->addr = (uint64_t)fd;
+    sqe->user_data = URING_INTERNAL;
+    // 调用方随后会关闭 fd，立即提交，避免 fd 号被复用后撤销错误的请求
+    return ring_submit(&uring->ring);
+}
+
+// 分配一个完成式请求并取得它的提交队列项
+static struct io_uring_sqe *op_start(UringReactor *uring, int kind, uint64_t data, int *index) {
+    if (uring->op_free < 0) {
+        int capacity = uring->op_capacity ? uring->op_capacity * 2 : 256;
+        UringOp *ops = realloc(uring->ops, capacity * sizeof(UringOp));
+        if (!ops) {
+            return NULL;
+        }
+        for (int i = capacity; i-- > uring->op_capacity;) {
+            ops[i].kind = 0;
+            ops[i].next_free = uring->op_free;
+            uring->op_free = i;
+        }
+        uring->ops = ops;
+        uring->op_capacity = capacity;
+    }
+
+    struct io_uring_sqe *sqe = ring_get_sqe(&uring->ring);
+    if (!sqe) {
+        return NULL;
+    }
+    int i = uring->op_free;
+    UringOp *op = &uring->ops[i];
+    uring->op_free = op->next_free;
+    op->kind = kind;
+    op->accept = -1;
+    op->data = data;
+    uring->op_pending++;
+    sqe->user_data = URING_OP_FLAG | (uint64_t)i;
+    *index = i;
+    return sqe;
+}
+
+static void op_finish(UringReactor *uring, int index) {
+    UringOp *op = &uring->ops[index];
+    if (op->accept >= 0) {
+        uring->accepts[op->accept].busy = 0;
+    }
+    op->kind = 0;
+    op->next_free = uring->op_free;
+    uring->op_free = index;
+    uring->op_pending--;
+}
+
+int uring_reactor_accept(UringReactor *uring, int fd, uint64_t data) {
+    int slot = 0;
+    while (slot < URING_ACCEPT_MAX && uring->accepts[slot].busy) {
+        slot++;
+    }
+    if (slot == URING_ACCEPT_MAX) {
+        errno = EBUSY;
+        return -1;
+    }
+
+    int index;
+    struct io_uring_sqe *sqe = op_start(uring, REACTOR_ACCEPTED, data, &index);
+    if (!sqe) {
+        return -1;
+    }
+    UringAccept *accept = &uring->accepts[slot];
+    accept->busy = 1;
+    accept->len = sizeof(accept->addr);
+    uring->ops[index].accept = slot;
+
+    sqe->opcode = IORING_OP_ACCEPT;
+    sqe->fd = fd;
+    sqe->addr = (uint64_t)(uintptr_t)&accept->addr;
+    sqe->addr2 = (uint64_t)(uintptr_t)&accept->len;
+    sqe->accept_flags = SOCK_CLOEXEC;
+    return 0;
+}
+
+int uring_reactor_recv(UringReactor *uring, int fd, void *buffer, size_t len, uint64_t data) {
+    int index;
+    struct io_uring_sqe *sqe = op_start(uring, REACTOR_RECEIVED, data, &index);
+    if (!sqe) {
+        return -1;
+    }
+    sqe->opcode = IORING_OP_RECV;
+    sqe->fd = fd;
+    if (buffer) {
+        sqe->addr = (uint64_t)(uintptr_t)buffer;
+        sqe->len = len > UINT32_MAX ? UINT32_MAX : (uint32_t)len;
+    } else {
+        // 等待中的连接通常还没有数据，先等可读再从池中取缓冲区
+        sqe->flags = IOSQE_BUFFER_SELECT;
+        sqe->buf_group = URING_BUFFER_GROUP;
+        sqe->len = URING_BUFFER_SIZE;
+        sqe->ioprio = IORING_RECVSEND_POLL_FIRST;
+    }
+    return 0;
+}
+
+int uring_reactor_sendmsg(UringReactor *uring, int fd, const struct msghdr *msg, uint64_t data) {
+    int index;
+    struct io_uring_sqe *sqe = op_start(uring, REACTOR_SENT, data, &index);
+    if (!sqe) {
+        return -1;
+    }
+    sqe->opcode = IORING_OP_SENDMSG;
+    sqe->fd = fd;
+    sqe->addr = (uint64_t)(uintptr_t)msg;
+    sqe->len = 1;
+    sqe->msg_flags = MSG_NOSIGNAL;
+    return 0;
+}
+
+int uring_reactor_cancel(UringReactor *uring, int fd) {
+    struct io_uring_sqe *sqe = ring_get_sqe(&uring->ring);
+    if (!sqe) {
+        return -1;
+    }
+    sqe->opcode = IORING_OP_ASYNC_CANCEL;
+    sqe->fd = fd;
+    sqe->cancel_flags = IORING_ASYNC_CANCEL_FD | IORING_ASYNC_CANCEL_ALL;
+    sqe->user_data = URING_INTERNAL;
+    return 0;
+}
+
+void uring_reactor_recycle(UringReactor *uring, const ReactorEvent *event) {
+    if (event->buffer) {
+        buffer_add(uring, event->buffer_id);
+    }
+}
+
+// 把一个完成式请求的结果转换为事件
+static void op_event(UringReactor *uring, const struct io_uring_cqe *cqe, ReactorEvent *event) {
+    int index = (int)(uint32_t)cqe->user_data;
+    UringOp *op = &uring->ops[index];
+    event->events = op->kind;
+    event->data = op->data;
+    event->result = cqe->res;
+    event->buffer = NULL;
+    event->buffer_id = -1;
+    if (cqe->flags & IORING_CQE_F_BUFFER) {
+        event->buffer_id = (int)(cqe->flags >> IORING_CQE_BUFFER_SHIFT);
+        event->buffer = uring->buffers + (size_t)event->buffer_id * URING_BUFFER_SIZE;
+    }
+    if (op->accept >= 0) {
+        event->peer = uring->accepts[op->accept].addr;
+    }
+    op_finish(uring, index);
+}
+
+int uring_reactor_wait(UringReactor *uring, ReactorEvent *events, int max_events, int timeout_ms) {
+    UringRing *ring = &uring->ring;
+    unsigned head = *ring->cq_head;
+    if (head == __atomic_load_n(ring->cq_tail, __ATOMIC_ACQUIRE)) {
+        // 提交排队的请求并等待至少一个完成事件，只需一次系统调用
+        struct __kernel_timespec ts;
+        struct io_uring_getevents_arg arg;
+        memset(&arg, 0, sizeof(arg));
+        if (timeout_ms >= 0) {
+            ts.tv_sec = timeout_ms / 1000;
+            ts.tv_nsec = (timeout_ms % 1000) * 1000000LL;
+            arg.ts = (uint64_t)(uintptr_t)&ts;
+        }
+
+        int n = sys_io_uring_enter(ring->fd, ring->to_submit, 1,
+                                   IORING_ENTER_GETEVENTS | IORING_ENTER_EXT_ARG,
+                                   &arg, sizeof(arg));
+        if (n < 0) {
+            if (errno == EINTR || errno == ETIME) {
+                return 0;
+            }
+            return -1;
+        }
+        ring->to_submit -= n;
+    } else if (ring_submit(ring) < 0) {
+        return -1;
+    }
+
+    int ready = 0;
+    unsigned tail = __atomic_load_n(ring->cq_tail, __ATOMIC_ACQUIRE);
+    while (head != tail && ready < max_events) {
+        struct io_uring_cqe *cqe = &ring->cqes[head & *ring->cq_mask];
+        head++;
+
+        if (cqe->user_data == URING_INTERNAL) {
+            continue;
+        }
+        if (cqe->user_data & URING_OP_FLAG) {
+            op_event(uring, cqe, &events[ready++]);
+            continue;
+        }
+        int fd = (int)cqe->user_data;
+        if (fd >= uring->fd_capacity || !uring->fds[fd].armed || cqe->res == -ECANCELED) {
+            // 已删除的 fd 残留的事件
+            continue;
+        }
+
+        int ev = 0;
+        if (cqe->res < 0) {
+            ev = REACTOR_HUP | REACTOR_READ;
+        } else {
+            if (cqe->res & POLLIN) {
+                ev |= REACTOR_READ;
+            }
+            if (cqe->res & POLLOUT) {
+                ev |= REACTOR_WRITE;
+            }
+            if (cqe->res & (POLLHUP | POLLERR | POLLRDHUP)) {
+                ev |= REACTOR_HUP | REACTOR_READ;
+            }
+        }
+        events[ready].events = ev;
+        events[ready].data = uring->fds[fd].data;
+        events[ready].buffer = NULL;
+        ready++;
+
+        // 多次触发的 poll 被内核终止时重新提交
+        if (!(cqe->flags & IORING_CQE_F_MORE) && cqe->res >= 0) {
+            uring_arm(uring, fd);
+        }
+    }
+    __atomic_store_n(ring->cq_head, head, __ATOMIC_RELEASE);
+    return ready;
+}
+
+UringWriter *uring_writer_create(void) {
+    UringWriter *writer = calloc(1, sizeof(UringWriter));
+    if (!writer) {
+        return NULL;
+    }
+    if (ring_init(&writer->ring, URING_WRITER_ENTRIES, URING_WRITER_ENTRIES * 2) < 0) {
+        free(writer);
+        return NULL;
+    }
+    return writer;
+}
+
+void uring_writer_destroy(UringWriter *writer) {
+    if (writer) {
+        ring_free(&writer->ring);
+        free(writer);
+    }
+}
+
+int uring_writer_write(UringWriter *writer, int fd, const void *data, size_t len, uint64_t offset, int index) {
+    struct io_uring_sqe *sqe = ring_get_sqe(&writer->ring);
+    if (!sqe) {
+        return -1;
+    }
+    sqe->opcode = IORING_OP_WRITE;
+    sqe->fd = fd;
+    sqe->addr = (uint64_t)(uintptr_t)data;
+    sqe->len = len > UINT32_MAX ? UINT32_MAX : (uint32_t)len;
+    sqe->off = offset;
+    sqe->user_data = (uint64_t)index;
+    return 0;
+}
+
+int uring_writer_wait(UringWriter *writer, int *results, int count) {
+    UringRing *ring = &writer->ring;
+    int ret = 0;
+    int done = 0;
+    while (done < count) {
+        unsigned head = *ring->cq_head;
+        unsigned tail = __atomic_load_n(ring->cq_tail, __ATOMIC_ACQUIRE);
+        while (head != tail) {
+            struct io_uring_cqe *cqe = &ring->cqes[head & *ring->cq_mask];
+            head++;
+            results[cqe->user_data] = cqe->res;
+            done++;
+        }
+        __atomic_store_n(ring->cq_head, head, __ATOMIC_RELEASE);
+        if (done >= count) {
+            break;
+        }
+
+        // 提交全部写入并等待剩余的完成，通常整批只需一次系统调用
+        int n = sys_io_uring_enter(ring->fd, ring->to_submit, 1, IORING_ENTER_GETEVENTS, NULL, 0);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            if (ring->to_submit == 0) {
+                return -1;
+            }
+            // 提交失败：撤回尚未提交的写入，它们的 results 保持调用方的初始值，只等已提交的完成
+            count -= ring->to_submit;
+            __atomic_store_n(ring->sq_tail, *ring->sq_tail - ring->to_submit, __ATOMIC_RELEASE);
+            ring->to_submit = 0;
+            ret = -1;
+            continue;
+        }
+        ring->to_submit -= n;
+    }
+    return ret;
+}
+
+#endif
@@ -0,0 +1,34 @@
+#ifndef REACTOR_URING_H
+#define REACTOR_URING_H
+
+#include "reactor.h"
+
+// io_uring 事件后端，仅在 Linux 上以 -DUSE_IO_URING 编译时可用。
+// 注册/修改/删除操作放入提交队列，与等待事件合并为一次 io_uring_enter。
+// 注册接收缓冲区池成功时还支持完成式的 accept/recv/sendmsg。
+typedef struct UringReactor UringReactor;
+typedef struct UringWriter UringWriter;
+
+// 内核不支持 io_uring 时返回 NULL，调用方退回 epoll
+UringReactor *uring_reactor_create(void);
+void uring_reactor_destroy(UringReactor *uring);
+int uring_reactor_add(UringReactor *uring, int fd, int events, uint64_t data);
+int uring_reactor_mod(UringReactor *uring, int fd, int events, uint64_t data);
+int uring_reactor_del(UringReactor *uring, int fd);
+int uring_reactor_wait(UringReactor *uring, ReactorEvent *events, int max_events, int timeout_ms);
+int uring_reactor_completions(UringReactor *uring);
+int uring_reactor_accept(UringReactor *uring, int fd, uint64_t data);
+int uring_reactor_recv(UringReactor *uring, int fd, void *buffer, size_t len, uint64_t data);
+int uring_reactor_sendmsg(UringReactor *uring, int fd, const struct msghdr *msg, uint64_t data);
+void uring_reactor_recycle(UringReactor *uring, const ReactorEvent *event);
+int uring_reactor_cancel(UringReactor *uring, int fd);
+
+// 批量写文件：uring_writer_write 只排队，uring_writer_wait 一次提交全部写入并等待 count 个完成，
+// results[index] 为对应写入的字节数或 -errno，index 为 results 的下标。
+// 提交失败时返回-1，没能提交的写入不会完成，其 results 保持不变
+UringWriter *uring_writer_create(void);
+void uring_writer_destroy(UringWriter *writer);
+int uring_writer_write(UringWriter *writer, int fd, const void *data, size_t len, uint64_t offset, int index);
+int uring_writer_wait(UringWriter *writer, int *results, int count);
+
+#endif
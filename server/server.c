@@ -1,509 +1,1460 @@
-#include <stdio.h>
-#include <stdlib.h>
-#include <string.h>
-#include <unistd.h>
-#include <sys/socket.h>
-#include <netinet/in.h>
-#include <arpa/inet.h>
-#include <time.h>
-#include <pthread.h>
-#include <termios.h>
-#include <fcntl.h>
-#include <errno.h>
-#include "cJSON.h"
-#include <sys/types.h>
-
-#define PORT 5566
-#define BUFFER_SIZE 1024
-#define MAX_CLIENTS 10
-#define COMMAND_INTERVAL 5  // Send command every 5 seconds
-#define SERVER_STREAM_UPLOAD_URL "rtmp://192.168.1.100/stream"
-#define BROADCAST_PORT 5567
-#define BROADCAST_INTERVAL 5  // 每5秒广播一次
-
-typedef struct {
-    int socket;
-    char rtsp_url[256];
-    char reason[256];
-    char ip_addr[INET_ADDRSTRLEN];
-} ClientInfo;
-
-ClientInfo clients[MAX_CLIENTS];
-int client_count = 0;
-pthread_mutex_t clients_mutex = PTHREAD_MUTEX_INITIALIZER;
-
-// 函数原型声明
-void handle_client_message_by_index(int client_index, char *buffer);
-
-// 发送设置RTSP URL命令
-void send_upload_url(int client_socket, const char *url) {
-    cJSON *root = cJSON_CreateObject();
-    cJSON_AddStringToObject(root, "upload_url", url);
-    cJSON_AddNumberToObject(root, "timestamp", (double)time(NULL));
-    
-    char *json_str = cJSON_PrintUnformatted(root);
-    send(client_socket, json_str, strlen(json_str), 0);
-    printf("responese upload url: %s\n", url);
-    
-    free(json_str);
-    cJSON_Delete(root);
-}
-
-// 发送状态检查命令
-void send_check_status(int client_socket) {
-    cJSON *root = cJSON_CreateObject();
-    cJSON_AddStringToObject(root, "command", "check_status");
-    cJSON_AddNumberToObject(root, "timestamp", (double)time(NULL));
-    
-    char *json_str = cJSON_PrintUnformatted(root);
-    send(client_socket, json_str, strlen(json_str), 0);
-    printf("send check status\n");
-    free(json_str);
-    cJSON_Delete(root);
-}
-
-// 发送移动命令
-void send_move_command(int client_socket, const char *direction, int duration) {
-    cJSON *root = cJSON_CreateObject();
-    cJSON_AddStringToObject(root, "command", "move");
-    cJSON_AddStringToObject(root, "direction", direction);
-    cJSON_AddNumberToObject(root, "duration", duration);
-    cJSON_AddNumberToObject(root, "timestamp", (double)time(NULL));
-    
-    char *json_str = cJSON_PrintUnformatted(root);
-    send(client_socket, json_str, strlen(json_str), 0);
-    printf("send move command: %s, %d\n", direction, duration);
-    free(json_str);
-    cJSON_Delete(root);
-}
-
-// 发送获取JPEG图像命令
-void send_get_jpeg_command(int client_socket) {
-    cJSON *root = cJSON_CreateObject();
-    cJSON_AddStringToObject(root, "command", "get_jpeg");
-    cJSON_AddNumberToObject(root, "timestamp", (double)time(NULL));
-    
-    char *json_str = cJSON_PrintUnformatted(root);
-    send(client_socket, json_str, strlen(json_str), 0);
-    printf("send get_jpeg command\n");
-    free(json_str);
-    cJSON_Delete(root);
-}
-
-// 设置终端为非阻塞模式
-void set_nonblocking_input() {
-    struct termios ttystate;
-    tcgetattr(STDIN_FILENO, &ttystate);
-    ttystate.c_lflag &= ~(ICANON | ECHO);
-    tcsetattr(STDIN_FILENO, TCSANOW, &ttystate);
-    
-    int flags = fcntl(STDIN_FILENO, F_GETFL);
-    fcntl(STDIN_FILENO, F_SETFL, flags | O_NONBLOCK);
-}
-
-// 恢复终端设置
-void reset_terminal() {
-    struct termios ttystate;
-    tcgetattr(STDIN_FILENO, &ttystate);
-    ttystate.c_lflag |= ICANON | ECHO;
-    tcsetattr(STDIN_FILENO, TCSANOW, &ttystate);
-    
-    int flags = fcntl(STDIN_FILENO, F_GETFL);
-    fcntl(STDIN_FILENO, F_SETFL, flags & ~O_NONBLOCK);
-}
-
-
-// 显示帮助信息
-void show_help() {
-    printf("\n可用命令:\n");
-    printf("  c - 向所有客户端发送状态检查命令\n");
-    printf("  m - 发送移动命令 (会提示输入方向和时间)\n");
-    printf("  j - 请求所有客户端发送一张JPEG图像\n");
-    printf("  h - 显示此帮助信息\n");
-    printf("  q - 退出服务器\n");
-}
-
-// 处理键盘输入的线程函数
-void *keyboard_thread(void *arg) {
-    (void)arg;  // 显式忽略未使用的参数
-    set_nonblocking_input();
-    show_help();
-    
-    char c;
-    char input_buffer[256];
-    
-    while (1) {
-        if (read(STDIN_FILENO, &c, 1) > 0) {
-            switch (c) {
-                case 'c':
-                    pthread_mutex_lock(&clients_mutex);
-                    for (int i = 0; i < client_count; i++) {
-                        send_check_status(clients[i].socket);
-                    }
-                    pthread_mutex_unlock(&clients_mutex);
-                    break;
-                    
-                case 'm': {
-                    printf("Input move direction (F/B/L/R/FL/FR/BL/BR/STOP): ");
-                    reset_terminal();
-                    fgets(input_buffer, sizeof(input_buffer), stdin);
-                    input_buffer[strcspn(input_buffer, "\n")] = 0;
-                    
-                    char direction[20];
-                    strncpy(direction, input_buffer, sizeof(direction) - 1);
-                    direction[sizeof(direction) - 1] = '\0';
-                    
-                    printf("Input move duration(seconds): ");
-                    fgets(input_buffer, sizeof(input_buffer), stdin);
-                    int duration = atoi(input_buffer);
-                    
-                    pthread_mutex_lock(&clients_mutex);
-                    for (int i = 0; i < client_count; i++) {
-                        send_move_command(clients[i].socket, direction, duration);
-                    }
-                    pthread_mutex_unlock(&clients_mutex);
-                    set_nonblocking_input();
-                    break;
-                }
-                
-                case 'j':
-                    pthread_mutex_lock(&clients_mutex);
-                    for (int i = 0; i < client_count; i++) {
-                        send_get_jpeg_command(clients[i].socket);
-                    }
-                    pthread_mutex_unlock(&clients_mutex);
-                    break;
-                    
-                case 'h':
-                    show_help();
-                    break;
-                    
-                case 'q':
-                    printf("Exiting...\n");
-                    reset_terminal();
-                    exit(0);
-                    break;
-            }
-        }
-        usleep(100000); // 休眠100毫秒，减少CPU使用率
-    }
-    
-    return NULL;
-}
-
-// 修改客户端处理线程函数
-void *client_handler(void *arg) {
-    int client_index = *((int *)arg);
-    free(arg);
-    
-    int client_socket = clients[client_index].socket;
-    char buffer[BUFFER_SIZE];
-    
-    while (1) {
-        int bytes_read = recv(client_socket, buffer, BUFFER_SIZE - 1, 0);
-        
-        if (bytes_read > 0) {
-            buffer[bytes_read] = '\0';
-            
-            // 直接使用客户端索引处理消息
-            handle_client_message_by_index(client_index, buffer);
-        } else if (bytes_read == 0) {
-            // 客户端断开连接
-            printf("client %s disconnect\n\n", clients[client_index].ip_addr);
-            
-            pthread_mutex_lock(&clients_mutex);
-            // 移除客户端
-            for (int j = client_index; j < client_count - 1; j++) {
-                clients[j] = clients[j + 1];
-            }
-            client_count--;
-            pthread_mutex_unlock(&clients_mutex);
-            
-            close(client_socket);
-            break;
-        } else {
-            // 接收错误
-            perror("receive data failed");
-            close(client_socket);
-            break;
-        }
-    }
-    
-    return NULL;
-}
-
-// 接收客户端发送的JPEG图像
-int receive_jpeg_image(int client_socket, const char *client_ip, long long size) {
-    char image_path[256];
-    time_t current_time = time(NULL);
-    struct tm *time_info = localtime(&current_time);
-    
-    // 创建保存图像的目录
-    mkdir("images", 0755);
-    
-    // 生成唯一文件名，包含客户端IP和时间
-    sprintf(image_path, "images/%s_%04d%02d%02d_%02d%02d%02d.jpg",
-            client_ip,
-            time_info->tm_year + 1900, time_info->tm_mon + 1, time_info->tm_mday,
-            time_info->tm_hour, time_info->tm_min, time_info->tm_sec);
-    
-    // 打开文件进行写入
-    FILE *fp = fopen(image_path, "wb");
-    if (!fp) {
-        perror("无法创建图像文件");
-        return -1;
-    }
-    
-    printf("正在接收图像数据，大小: %lld 字节\n", size);
-    
-    // 读取并保存图像数据
-    char buffer[4096];
-    size_t bytes_read;
-    size_t total_received = 0;
-    
-    while (total_received < size) {
-        bytes_read = recv(client_socket, buffer, 
-                         sizeof(buffer) < (size - total_received) ? sizeof(buffer) : (size - total_received), 
-                         0);
-        
-        if (bytes_read <= 0) {
-            perror("接收图像数据失败");
-            fclose(fp);
-            return -1;
-        }
-        
-        fwrite(buffer, 1, bytes_read, fp);
-        total_received += bytes_read;
-        
-        // 显示进度
-        printf("\r接收进度: %.1f%%", (total_received * 100.0) / size);
-        fflush(stdout);
-    }
-    
-    printf("\n图像接收完成，已保存至 %s\n", image_path);
-    fclose(fp);
-    
-    return 0;
-}
-
-// 添加一个新函数，通过索引处理客户端消息
-void handle_client_message_by_index(int client_index, char *buffer) {
-    ClientInfo *client = &clients[client_index];
-    
-    cJSON *root = cJSON_Parse(buffer);
-    if (root) {
-        char *json_str = cJSON_Print(root);
-        printf("\n%s\n", json_str);
-        free(json_str);
-
-        // 处理初始化消息
-        cJSON *reason = cJSON_GetObjectItem(root, "reason");
-        cJSON *rtsp_url = cJSON_GetObjectItem(root, "rtsp_url");
-        
-        // 处理图像响应
-        cJSON *response = cJSON_GetObjectItem(root, "response");
-        cJSON *size = cJSON_GetObjectItem(root, "size");
-        
-        if (reason) {
-            // 初始化消息处理
-            strcpy(client->reason, reason->valuestring);
-            printf("Client %s (ID: %d):\n", client->ip_addr, client_index);
-            printf("reason: %s\n", client->reason);
-            if (rtsp_url) {
-                strcpy(client->rtsp_url, rtsp_url->valuestring);
-                printf("rtsp_url: %s\n", client->rtsp_url);
-            }
-
-            send_upload_url(client->socket, SERVER_STREAM_UPLOAD_URL);
-        } else if (response && strcmp(response->valuestring, "jpeg_image") == 0 && size) {
-            // JPEG图像响应处理
-            printf("接收到图像响应，客户端: %s\n", client->ip_addr);
-            
-            // 接收图像数据
-            receive_jpeg_image(client->socket, client->ip_addr, (long long)size->valuedouble);
-        }
-        cJSON_Delete(root);
-    }
-}
-
-// 广播线程函数
-void *broadcast_thread(void *arg) {
-    int broadcast_sock;
-    struct sockaddr_in broadcast_addr;
-    int broadcast_enable = 1;
-    char broadcast_message[256];
-    
-    // 创建UDP套接字
-    if ((broadcast_sock = socket(AF_INET, SOCK_DGRAM, 0)) < 0) {
-        perror("broadcast socket create failed");
-        return NULL;
-    }
-    
-    // 设置广播选项
-    if (setsockopt(broadcast_sock, SOL_SOCKET, SO_BROADCAST, &broadcast_enable, sizeof(broadcast_enable)) < 0) {
-        perror("set broadcast option failed");
-        close(broadcast_sock);
-        return NULL;
-    }
-    
-    // 设置广播地址
-    memset(&broadcast_addr, 0, sizeof(broadcast_addr));
-    broadcast_addr.sin_family = AF_INET;
-    broadcast_addr.sin_port = htons(BROADCAST_PORT);
-    broadcast_addr.sin_addr.s_addr = inet_addr("255.255.255.255");  // 广播地址
-    
-    // 获取本机IP地址
-    char host_ip[INET_ADDRSTRLEN];
-    struct sockaddr_in host_addr;
-    socklen_t host_len = sizeof(host_addr);
-    
-    // 创建一个临时套接字来获取本机IP
-    int temp_sock = socket(AF_INET, SOCK_DGRAM, 0);
-    if (temp_sock < 0) {
-        perror("temp socket create failed");
-        close(broadcast_sock);
-        return NULL;
-    }
-    
-    // 连接到一个外部地址（不会真正发送数据）
-    memset(&host_addr, 0, sizeof(host_addr));
-    host_addr.sin_family = AF_INET;
-    host_addr.sin_port = htons(80);
-    host_addr.sin_addr.s_addr = inet_addr("8.8.8.8");  // 谷歌DNS服务器
-    
-    if (connect(temp_sock, (struct sockaddr*)&host_addr, sizeof(host_addr)) < 0) {
-        perror("temp connect failed");
-        close(temp_sock);
-        close(broadcast_sock);
-        return NULL;
-    }
-    
-    // 获取本机地址
-    if (getsockname(temp_sock, (struct sockaddr*)&host_addr, &host_len) < 0) {
-        perror("get local ip failed");
-        close(temp_sock);
-        close(broadcast_sock);
-        return NULL;
-    }
-    
-    inet_ntop(AF_INET, &host_addr.sin_addr, host_ip, INET_ADDRSTRLEN);
-    close(temp_sock);
-    
-    printf("server ip: %s\n", host_ip);
-    
-    // 准备广播消息
-    snprintf(broadcast_message, sizeof(broadcast_message), 
-             "{\"server_ip\":\"%s\",\"server_port\":%d}", 
-             host_ip, PORT);
-    
-    // 广播循环
-    while (1) {
-        if (sendto(broadcast_sock, broadcast_message, strlen(broadcast_message), 0,
-                  (struct sockaddr*)&broadcast_addr, sizeof(broadcast_addr)) < 0) {
-            perror("broadcast send failed");
-        } else {
-            printf("Broadcast message: %s\n", broadcast_message);
-        }
-        
-        sleep(BROADCAST_INTERVAL);
-    }
-    
-    close(broadcast_sock);
-    return NULL;
-}
-
-int main() {
-    int server_fd, new_socket;
-    struct sockaddr_in address;
-    int opt = 1;
-    int addrlen = sizeof(address);
-    
-    // 创建套接字
-    if ((server_fd = socket(AF_INET, SOCK_STREAM, 0)) == 0) {
-        perror("socket failed");
-        exit(EXIT_FAILURE);
-    }
-    
-    // 设置套接字选项
-    if (setsockopt(server_fd, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt))) {
-        perror("setsockopt");
-        exit(EXIT_FAILURE);
-    }
-    
-    address.sin_family = AF_INET;
-    address.sin_addr.s_addr = INADDR_ANY;
-    address.sin_port = htons(PORT);
-    
-    // 绑定套接字
-    if (bind(server_fd, (struct sockaddr *)&address, sizeof(address)) < 0) {
-        perror("bind failed");
-        exit(EXIT_FAILURE);
-    }
-    
-    // 监听连接
-    if (listen(server_fd, 3) < 0) {
-        perror("listen");
-        exit(EXIT_FAILURE);
-    }
-    
-    printf("server start, listen port %d\n", PORT);
-    
-    // 创建键盘输入线程
-    pthread_t kb_thread;
-    if (pthread_create(&kb_thread, NULL, keyboard_thread, NULL) != 0) {
-        perror("create keyboard thread failed");
-        exit(EXIT_FAILURE);
-    }
-    
-    // 在main函数中创建广播线程
-    pthread_t bc_thread;
-    if (pthread_create(&bc_thread, NULL, broadcast_thread, NULL) != 0) {
-        perror("create broadcast thread failed");
-        // 继续运行，不退出
-    }
-    
-    // 主循环接受客户端连接
-    while (1) {
-        if ((new_socket = accept(server_fd, (struct sockaddr *)&address, (socklen_t*)&addrlen)) < 0) {
-            perror("accept");
-            continue;
-        }
-        
-        char client_ip[INET_ADDRSTRLEN];
-        inet_ntop(AF_INET, &address.sin_addr, client_ip, INET_ADDRSTRLEN);
-        printf("----------------new client connect: %s----------------\n", client_ip);
-        
-        // 添加客户端到列表
-        pthread_mutex_lock(&clients_mutex);
-        if (client_count < MAX_CLIENTS) {
-            clients[client_count].socket = new_socket;
-            strcpy(clients[client_count].rtsp_url, "");
-            strcpy(clients[client_count].reason, "");
-            strcpy(clients[client_count].ip_addr, client_ip);
-            client_count++;
-            
-            // 为每个客户端创建一个处理线程
-            pthread_t client_thread;
-            int *client_idx = malloc(sizeof(int));
-            *client_idx = client_count - 1;  // 新添加的客户端索引
-            
-            if (pthread_create(&client_thread, NULL, client_handler, client_idx) != 0) {
-                perror("create client handler thread failed");
-                free(client_idx);
-            } else {
-                // 设置为分离状态，线程结束后自动释放资源
-                pthread_detach(client_thread);
-            }
-        } else {
-            printf("reach max client number, reject connection\n");
-            close(new_socket);
-        }
-        pthread_mutex_unlock(&clients_mutex);
-    }
-    
-    // 清理
-    pthread_join(kb_thread, NULL);
-    close(server_fd);
-    
-    return 0;
-} 
\ No newline at end of file
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <time.h>
+#include <pthread.h>
+#include <termios.h>
+#include <fcntl.h>
+#include <errno.h>
+#include "cJSON.h"
+#include "reactor.h"
+#include "frame.h"
+#include "fanout.h"
+#include "slotmap.h"
+#include "wire.h"
+#include "image_store.h"
+#include "disk_writer.h"
+#include "frame_cache.h"
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <stdint.h>
+#include <sys/uio.h>
+#include <sys/resource.h>
+
+#define PORT 5566
+#define BUFFER_SIZE 1024
+#define MAX_CLIENTS 100000
+#define COMMAND_INTERVAL 5  // Send command every 5 seconds
+#define SERVER_STREAM_UPLOAD_URL "rtmp://192.168.1.100/stream"
+#define BROADCAST_PORT 5567
+#define BROADCAST_INTERVAL 5  // 每5秒广播一次
+#define MAX_EVENTS 64
+#define MAX_SHARDS 64  // 事件循环线程数上限
+#define OUTQUEUE_MAX_BYTES (1024 * 1024)  // 出站积压超过该值的客户端被断开
+#define IMAGE_DIR "images"
+#define IMAGE_SEGMENT_BYTES (256ULL * 1024 * 1024)  // 图像存储每个段文件的预分配大小
+#define IMAGE_QUEUE_BYTES (256 * 1024 * 1024)  // 接收中和等待写盘的图像数据上限
+#define DISK_WRITER_THREADS 2  // 默认写盘线程数
+#define FRAME_CACHE_SLOTS 4  // 每个机器人缓存最近几帧
+#define FRAME_CACHE_SLOT_BYTES (4 * 1024 * 1024)  // 缓存的单帧上限，更大的图像只写盘
+#define JPEG_MAX_AGE_MS 1000  // j 命令默认接受的缓存图像最大时间
+#define STREAM_CREDITS 8  // 推流的流控窗口：客户端最多有这么多帧尚未被服务器收完
+#define STREAM_REPORT_INTERVAL 5  // 每隔几秒打印一次每个推流客户端的帧率
+#define ACCEPTS_IN_FLIGHT 8  // 完成模式下每个分片保持在途的 accept 数
+
+// 事件循环中非客户端的事件源，最高位区别于客户端句柄
+#define TOKEN_LISTENER ((uint64_t)1 << 63)
+#define TOKEN_MAILBOX (((uint64_t)1 << 63) | 1)
+
+typedef struct Shard Shard;
+
+typedef struct {
+    Shard *shard;  // 所属分片，连接只由该分片的线程处理
+    SlotHandle handle;
+    int socket;
+    char rtsp_url[256];
+    char reason[256];
+    char ip_addr[INET_ADDRSTRLEN];
+    FrameBuffer rx;  // 接收重组缓冲区
+    OutQueue tx;     // 出站队列
+    int writable_wait;  // 出站队列未写完，正在等待可写事件
+    int closing;        // 发送失败或积压过多，由事件循环断开
+    // 完成模式：每个连接最多一个在途的接收和一个在途的发送，内核使用期间不能释放连接
+    int recv_pending;
+    int send_pending;
+    int cancelled;      // 已提交取消，等在途的请求全部完成后释放
+    struct msghdr send_msg;
+    struct iovec send_iov[OUTQUEUE_MAX_IOV];
+    int compact;        // 已在 init_slam 中协商紧凑编码
+    // 收到 jpeg_image 头后等待的图像数据帧：1 为接收，-1 为读走丢弃
+    int image_expected;
+    // 正在接收的二进制帧，数据直接收进写盘任务的缓冲区，image 为 NULL 时丢弃数据
+    DiskJob *image;
+    FrameRing *frames;  // 本机器人的最新图像缓存，第一次收到图像时创建
+    // 推流：stream_window 为0表示没有订阅；每收完半个窗口的帧归还一次额度
+    int stream_window;
+    int stream_outstanding;  // 已发放给客户端、尚未用掉的额度
+    int stream_consumed;  // 收完但尚未归还额度的帧数
+    int image_streamed;   // 正在接收的图像是订阅中、额度之内的一帧推流
+    long long stream_frames;  // 自上次打印帧率以来收到的帧数
+    long long stream_bytes;
+    struct timespec stream_report;
+    long long image_size;
+    long long image_remaining;
+    struct timespec image_start;
+} ClientInfo;
+
+// 图像接收统计
+typedef struct {
+    long long images;
+    long long bytes;
+    long long cpu_ns;  // 事件循环在图像数据上花费的CPU时间
+    long long cache_hits;  // 由缓存中的图像代替重新获取的次数
+    long long stream_frames;  // 推流收到的帧数
+    long long streams;     // 正在推流的客户端数
+} IngestStats;
+
+// 收完的图像交给写盘线程追加到图像存储，事件循环不做磁盘操作
+ImageStore image_store;
+DiskWriter disk_writer;
+// 每个机器人最近几帧的共享内存缓存，其他进程可以直接读取
+FrameCache frame_cache;
+int64_t jpeg_max_age_ns = JPEG_MAX_AGE_MS * 1000000LL;
+
+// 每个事件循环线程一个分片：独立的监听套接字、客户端表和命令邮箱。
+// 分片之间不共享客户端，键盘线程的命令通过各分片的无锁邮箱投递。
+struct Shard {
+    int id;
+    int listen_fd;    // 支持 SO_REUSEPORT 时每个分片一个，由内核分配新连接
+    Reactor *reactor;
+    int completions;  // 事件循环支持完成式 I/O：accept/recv/send 都提交给内核执行
+    int accepts;      // 完成模式下在途的 accept 数
+    SlotMap clients;  // 本分片的客户端表，按IP建立索引，只由本线程访问
+    Mailbox mailbox;  // 键盘线程 -> 本分片的事件循环
+    IngestStats stats;
+    pthread_t thread;
+};
+
+Shard *shards;
+int shard_count;
+int server_stopping;  // 键盘线程置位后各分片的事件循环退出
+
+// 统计计数由分片线程更新、键盘线程读取
+static void stat_add(long long *counter, long long value) {
+    __atomic_add_fetch(counter, value, __ATOMIC_RELAXED);
+}
+
+static long long elapsed_ns(const struct timespec *start, const struct timespec *end) {
+    return (end->tv_sec - start->tv_sec) * 1000000000LL + (end->tv_nsec - start->tv_nsec);
+}
+
+// 函数原型声明
+void handle_client_message(ClientInfo *client, const char *buffer, size_t len);
+void handle_client_compact(ClientInfo *client, const char *buffer, size_t len);
+int read_client(ClientInfo *client);
+int process_client_frames(ClientInfo *client);
+int start_receive_jpeg_image(ClientInfo *client, long long size);
+size_t receive_jpeg_image(ClientInfo *client, const char *data, size_t len);
+ssize_t recv_jpeg_image(ClientInfo *client);
+static void finish_jpeg_image(ClientInfo *client);
+void show_ingest_stats(void);
+
+// 把消息编码为可共享的出站帧：JSON 编码，with_compact 时附带紧凑编码
+OutMsg *encode_message(const WireMessage *wire, int with_compact) {
+    char json[WIRE_JSON_MAX];
+    int json_len = wire_encode_json(wire, json, sizeof(json));
+    if (json_len < 0) {
+        return NULL;
+    }
+    OutMsg *msg = outmsg_create(FRAME_JSON, json, json_len);
+    if (msg) {
+        msg->wire_type = wire->type;
+    }
+
+    if (msg && with_compact) {
+        uint8_t buffer[WIRE_MESSAGE_MAX];
+        int len = wire_encode(wire, buffer, sizeof(buffer));
+        if (len > 0) {
+            msg->compact = outmsg_create(FRAME_COMPACT, buffer, len);
+        }
+    }
+    return msg;
+}
+
+// 设置RTSP URL命令，作为 init_slam 的回复，compact 表示同意使用紧凑编码
+OutMsg *build_upload_url(const char *url, int compact) {
+    WireMessage wire = { .type = WIRE_UPLOAD_URL, .upload_url = { .timestamp = time(NULL), .compact = compact } };
+    snprintf(wire.upload_url.url, sizeof(wire.upload_url.url), "%s", url);
+    return encode_message(&wire, 0);
+}
+
+// 状态检查命令
+OutMsg *build_check_status(void) {
+    WireMessage wire = { .type = WIRE_CHECK_STATUS, .check_status = { .timestamp = time(NULL) } };
+    return encode_message(&wire, 1);
+}
+
+// 移动命令
+OutMsg *build_move_command(const char *direction, int duration) {
+    WireMessage wire = { .type = WIRE_MOVE, .move = { .duration = duration, .timestamp = time(NULL) } };
+    snprintf(wire.move.direction, sizeof(wire.move.direction), "%s", direction);
+    return encode_message(&wire, 1);
+}
+
+// 获取JPEG图像命令，缓存中有不超过 max_age_ns 的图像的客户端不发送，0 表示都发送
+OutMsg *build_get_jpeg_command(int64_t max_age_ns) {
+    WireMessage wire = { .type = WIRE_GET_JPEG, .get_jpeg = { .timestamp = time(NULL) } };
+    OutMsg *msg = encode_message(&wire, 1);
+    if (msg) {
+        msg->max_age_ns = max_age_ns;
+    }
+    return msg;
+}
+
+// 推流命令：每秒 fps 帧，on_change 时只在画面变化时发送，两者都为0时停止推流
+OutMsg *build_subscribe_command(int fps, int on_change) {
+    int window = fps > 0 || on_change ? STREAM_CREDITS : 0;
+    WireMessage wire = { .type = WIRE_SUBSCRIBE,
+                         .subscribe = { .fps = fps, .on_change = on_change, .credits = window, .timestamp = time(NULL) } };
+    OutMsg *msg = encode_message(&wire, 1);
+    if (msg) {
+        msg->stream_window = window;
+    }
+    return msg;
+}
+
+// 归还推流额度
+OutMsg *build_credit_command(int frames) {
+    WireMessage wire = { .type = WIRE_CREDIT, .credit = { .frames = frames } };
+    return encode_message(&wire, 1);
+}
+
+// 把命令投递给每个分片的事件循环，由事件循环放入客户端的出站队列
+void broadcast_message(OutMsg *msg) {
+    if (!msg) {
+        printf("encode command failed\n");
+        return;
+    }
+    for (int i = 0; i < shard_count; i++) {
+        if (mailbox_post(&shards[i].mailbox, msg) < 0) {
+            perror("post command failed");
+        }
+    }
+    outmsg_unref(msg);
+}
+
+// 设置终端为非阻塞模式
+void set_nonblocking_input() {
+    struct termios ttystate;
+    tcgetattr(STDIN_FILENO, &ttystate);
+    ttystate.c_lflag &= ~(ICANON | ECHO);
+    tcsetattr(STDIN_FILENO, TCSANOW, &ttystate);
+    
+    int flags = fcntl(STDIN_FILENO, F_GETFL);
+    fcntl(STDIN_FILENO, F_SETFL, flags | O_NONBLOCK);
+}
+
+// 恢复终端设置
+void reset_terminal() {
+    struct termios ttystate;
+    tcgetattr(STDIN_FILENO, &ttystate);
+    ttystate.c_lflag |= ICANON | ECHO;
+    tcsetattr(STDIN_FILENO, TCSANOW, &ttystate);
+    
+    int flags = fcntl(STDIN_FILENO, F_GETFL);
+    fcntl(STDIN_FILENO, F_SETFL, flags & ~O_NONBLOCK);
+}
+
+
+// 显示帮助信息
+void show_help() {
+    printf("\n可用命令:\n");
+    printf("  c - 向所有客户端发送状态检查命令\n");
+    printf("  m - 发送移动命令 (会提示输入方向和时间)\n");
+    printf("  j - 请求所有客户端发送一张JPEG图像 (缓存中足够新的直接使用)\n");
+    printf("  J - 请求所有客户端重新拍摄JPEG图像\n");
+    printf("  f - 请求所有客户端持续推送图像 (会提示输入帧率)\n");
+    printf("  s - 显示图像接收统计\n");
+    printf("  h - 显示此帮助信息\n");
+    printf("  q - 退出服务器\n");
+}
+
+// 处理键盘输入的线程函数
+void *keyboard_thread(void *arg) {
+    (void)arg;  // 显式忽略未使用的参数
+    set_nonblocking_input();
+    show_help();
+    
+    char c;
+    char input_buffer[256];
+    
+    while (1) {
+        if (read(STDIN_FILENO, &c, 1) > 0) {
+            switch (c) {
+                case 'c':
+                    broadcast_message(build_check_status());
+                    printf("send check status\n");
+                    break;
+                    
+                case 'm': {
+                    printf("Input move direction (F/B/L/R/FL/FR/BL/BR/STOP): ");
+                    reset_terminal();
+                    fgets(input_buffer, sizeof(input_buffer), stdin);
+                    input_buffer[strcspn(input_buffer, "\n")] = 0;
+                    
+                    char direction[20];
+                    strncpy(direction, input_buffer, sizeof(direction) - 1);
+                    direction[sizeof(direction) - 1] = '\0';
+                    
+                    printf("Input move duration(seconds): ");
+                    fgets(input_buffer, sizeof(input_buffer), stdin);
+                    int duration = atoi(input_buffer);
+                    
+                    broadcast_message(build_move_command(direction, duration));
+                    printf("send move command: %s, %d\n", direction, duration);
+                    set_nonblocking_input();
+                    break;
+                }
+                
+                case 'j':
+                    broadcast_message(build_get_jpeg_command(jpeg_max_age_ns));
+                    printf("send get_jpeg command\n");
+                    break;
+
+                case 'f': {
+                    printf("Input frame rate (0 = stop, c = on change, e.g. 10 / c / 5c): ");
+                    reset_terminal();
+                    fgets(input_buffer, sizeof(input_buffer), stdin);
+                    int fps = atoi(input_buffer);
+                    int on_change = strchr(input_buffer, 'c') != NULL;
+
+                    broadcast_message(build_subscribe_command(fps > 0 ? fps : 0, on_change));
+                    printf("send subscribe command: %d fps%s\n", fps > 0 ? fps : 0, on_change ? ", on change" : "");
+                    set_nonblocking_input();
+                    break;
+                }
+
+                case 'J':
+                    broadcast_message(build_get_jpeg_command(0));
+                    printf("send get_jpeg command (no cache)\n");
+                    break;
+                    
+                case 's':
+                    show_ingest_stats();
+                    break;
+
+                case 'h':
+                    show_help();
+                    break;
+                    
+                case 'q':
+                    printf("Exiting...\n");
+                    reset_terminal();
+                    // 事件循环全部退出后，主线程再写完已收到的图像并关闭存储和缓存，
+                    // 此后不会再有分片写入共享内存或提交写盘
+                    __atomic_store_n(&server_stopping, 1, __ATOMIC_RELEASE);
+                    for (int i = 0; i < shard_count; i++) {
+                        mailbox_wake(&shards[i].mailbox);
+                    }
+                    return NULL;
+            }
+        }
+        usleep(100000); // 休眠100毫秒，减少CPU使用率
+    }
+    
+    return NULL;
+}
+
+static void shard_submit_accepts(Shard *shard);
+
+// 移除客户端并关闭连接
+void remove_client(Shard *shard, SlotHandle handle) {
+    ClientInfo *client = slotmap_get(&shard->clients, handle);
+    if (client) {
+        if (client->recv_pending || client->send_pending) {
+            // 内核还在使用这个连接的缓冲区：取消在途的请求，最后一个完成事件到达后再释放
+            client->closing = 1;
+            if (!client->cancelled && reactor_cancel(shard->reactor, client->socket) == 0) {
+                client->cancelled = 1;
+            }
+            return;
+        }
+        printf("client %s disconnect\n\n", client->ip_addr);
+        if (!shard->completions) {
+            reactor_del(shard->reactor, client->socket);
+        }
+        close(client->socket);
+        if (client->image) {
+            printf("图像接收未完成，丢弃\n");
+            disk_job_discard(&disk_writer, client->image);
+        }
+        if (client->stream_window > 0) {
+            stat_add(&shard->stats.streams, -1);
+        }
+        frame_buffer_free(&client->rx);
+        outqueue_clear(&client->tx);
+        slotmap_remove(&shard->clients, handle);
+        if (shard->completions) {
+            // 描述符不足时停下的 accept 在有连接释放后恢复
+            shard_submit_accepts(shard);
+        }
+    }
+}
+
+static int client_submit_recv(ClientInfo *client);
+
+// 把新连接加入本分片的客户端表并开始接收
+static void add_client(Shard *shard, int new_socket, const struct sockaddr_in *address) {
+    char client_ip[INET_ADDRSTRLEN];
+    inet_ntop(AF_INET, &address->sin_addr, client_ip, INET_ADDRSTRLEN);
+    printf("----------------new client connect: %s----------------\n", client_ip);
+
+    // 添加客户端到本分片的列表
+    SlotHandle handle;
+    ClientInfo *client = slotmap_insert(&shard->clients, client_ip, &handle);
+    if (client) {
+        client->shard = shard;
+        client->handle = handle;
+        client->socket = new_socket;
+        outqueue_init(&client->tx);
+        strcpy(client->ip_addr, client_ip);
+
+        // 完成模式下内核代为等待数据，套接字保持阻塞模式
+        int ret = shard->completions ? client_submit_recv(client) :
+                  set_socket_nonblocking(new_socket) < 0 ? -1 :
+                  reactor_add(shard->reactor, new_socket, REACTOR_READ, handle);
+        if (ret < 0) {
+            perror("register client socket failed");
+            close(new_socket);
+            slotmap_remove(&shard->clients, handle);
+        }
+    } else {
+        printf("reach max client number, reject connection\n");
+        close(new_socket);
+    }
+}
+
+// 接受所有排队的新连接（边沿触发，需要一直accept到EAGAIN）
+void accept_clients(Shard *shard) {
+    while (1) {
+        struct sockaddr_in address;
+        socklen_t addrlen = sizeof(address);
+        int new_socket = accept(shard->listen_fd, (struct sockaddr *)&address, &addrlen);
+        if (new_socket < 0) {
+            if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+                perror("accept");
+            }
+            if (errno == EINTR) {
+                continue;
+            }
+            return;
+        }
+        add_client(shard, new_socket, &address);
+    }
+}
+
+// 完成模式：保持一定数量的 accept 在途，连接风暴时新连接不必等事件循环逐个提交
+static void shard_submit_accepts(Shard *shard) {
+    while (shard->accepts < ACCEPTS_IN_FLIGHT &&
+           reactor_accept(shard->reactor, shard->listen_fd, TOKEN_LISTENER) == 0) {
+        shard->accepts++;
+    }
+}
+
+// 完成模式：一个 accept 完成，补上在途的 accept
+void client_accepted(Shard *shard, const ReactorEvent *event) {
+    shard->accepts--;
+    if (event->result >= 0) {
+        add_client(shard, event->result, &event->peer);
+    } else if (event->result != -EINTR && event->result != -ECONNABORTED) {
+        errno = -event->result;
+        perror("accept");
+        if (errno == EMFILE || errno == ENFILE || errno == ENOBUFS || errno == ENOMEM) {
+            // 资源不足时不再补上，等有连接释放后由 remove_client 恢复，避免空转
+            return;
+        }
+    }
+    shard_submit_accepts(shard);
+}
+
+// 完成模式：提交下一次接收。图像数据直接收进写盘任务的缓冲区，
+// 其余数据到达时才从接收缓冲区池取缓冲区，空闲连接不占用接收内存
+static int client_submit_recv(ClientInfo *client) {
+    void *buffer = NULL;
+    size_t len = 0;
+    if (client->image_remaining > 0 && client->image) {
+        buffer = client->image->data + (client->image_size - client->image_remaining);
+        len = (size_t)client->image_remaining;
+    }
+    if (reactor_recv(client->shard->reactor, client->socket, buffer, len, client->handle) < 0) {
+        return -1;
+    }
+    client->recv_pending = 1;
+    return 0;
+}
+
+// 完成模式：没有在途的发送时把出站队列队首的消息交给内核，完成后再提交剩余部分
+static int client_submit_send(ClientInfo *client) {
+    if (client->send_pending || !client->tx.head) {
+        return 0;
+    }
+    client->send_msg.msg_iov = client->send_iov;
+    client->send_msg.msg_iovlen = outqueue_prepare(&client->tx, client->send_iov, OUTQUEUE_MAX_IOV);
+    if (reactor_sendmsg(client->shard->reactor, client->socket, &client->send_msg, client->handle) < 0) {
+        return -1;
+    }
+    client->send_pending = 1;
+    return 0;
+}
+
+// 尽量写出出站队列，返回值同 outqueue_flush（完成模式下提交成功返回0）
+static int client_flush(ClientInfo *client) {
+    if (client->shard->completions) {
+        return client_submit_send(client);
+    }
+    return outqueue_flush(&client->tx, client->socket);
+}
+
+// 把消息放入客户端出站队列并尝试立即写出，失败时标记断开
+void client_send(ClientInfo *client, OutMsg *msg) {
+    if (client->closing) {
+        return;
+    }
+    if (client->compact && msg->compact) {
+        msg = msg->compact;
+    }
+    if (client->tx.bytes + msg->length > OUTQUEUE_MAX_BYTES) {
+        printf("客户端 %s 出站积压过多，断开连接\n", client->ip_addr);
+        client->closing = 1;
+        return;
+    }
+
+    // 旧协议的客户端只接收不带帧头的 JSON，为它单独复制一份
+    OutMsg *unframed = NULL;
+    if (client->rx.mode == FRAME_MODE_UNFRAMED) {
+        msg = unframed = outmsg_create_unframed(msg);
+        if (!msg) {
+            client->closing = 1;
+            return;
+        }
+    }
+    if (outqueue_push(&client->tx, msg) < 0 || client_flush(client) < 0) {
+        client->closing = 1;
+    }
+    outmsg_unref(unframed);
+}
+
+// 出站队列有积压时关注可写事件，写完后取消；完成模式下由发送完成事件推进，不关注可写事件
+int update_client_interest(Reactor *reactor, ClientInfo *client) {
+    if (client->shard->completions) {
+        return 0;
+    }
+    int want = client->tx.head != NULL;
+    if (want == client->writable_wait) {
+        return 0;
+    }
+    client->writable_wait = want;
+    return reactor_mod(reactor, client->socket,
+                       want ? REACTOR_READ | REACTOR_WRITE : REACTOR_READ,
+                       client->handle);
+}
+
+// 处理客户端套接字上的事件
+void service_client(Shard *shard, SlotHandle handle, int events) {
+    ClientInfo *client = slotmap_get(&shard->clients, handle);
+    if (!client) {
+        // 同一批事件中已经被移除
+        return;
+    }
+
+    int ok = 1;
+    if (events & REACTOR_WRITE) {
+        ok = outqueue_flush(&client->tx, client->socket) >= 0;
+    }
+    if (ok && (events & REACTOR_READ)) {
+        ok = read_client(client) == 0;
+    }
+    if (ok && !client->closing) {
+        ok = update_client_interest(shard->reactor, client) == 0;
+    }
+    if (!ok || client->closing) {
+        remove_client(shard, handle);
+    }
+}
+
+// 完成模式：处理一次接收的结果，返回-1表示连接已关闭
+static int client_received(ClientInfo *client, const ReactorEvent *event) {
+    if (event->result <= 0) {
+        if (event->result < 0) {
+            errno = -event->result;
+            perror("receive data failed");
+        }
+        return -1;
+    }
+
+    if (!event->buffer) {
+        // 图像数据已由内核直接收进写盘任务的缓冲区，拷贝在 reactor_wait 中完成，不计入这里的CPU时间
+        struct timespec cpu_start, cpu_end;
+        clock_gettime(CLOCK_THREAD_CPUTIME_ID, &cpu_start);
+        client->image_remaining -= event->result;
+        stat_add(&client->shard->stats.bytes, event->result);
+        clock_gettime(CLOCK_THREAD_CPUTIME_ID, &cpu_end);
+        stat_add(&client->shard->stats.cpu_ns, elapsed_ns(&cpu_start, &cpu_end));
+        if (client->image_remaining == 0) {
+            finish_jpeg_image(client);
+        }
+        return 0;
+    }
+
+    if (frame_buffer_append(&client->rx, event->buffer, (size_t)event->result) < 0) {
+        perror("receive data failed");
+        return -1;
+    }
+    if (process_client_frames(client) < 0) {
+        printf("协议错误，断开客户端 %s\n", client->ip_addr);
+        return -1;
+    }
+    // 空闲连接不保留接收缓冲区
+    frame_buffer_shrink(&client->rx);
+    return 0;
+}
+
+// 完成模式：处理客户端连接上的接收/发送完成事件，并提交下一次请求
+void complete_client(Shard *shard, const ReactorEvent *event) {
+    ClientInfo *client = slotmap_get(&shard->clients, event->data);
+    if (!client) {
+        reactor_recycle(shard->reactor, event);
+        return;
+    }
+
+    int ok = 1;
+    if (event->events & REACTOR_SENT) {
+        client->send_pending = 0;
+        if (!client->closing) {
+            ok = event->result > 0;
+            if (ok) {
+                outqueue_consume(&client->tx, (size_t)event->result);
+                ok = client_submit_send(client) == 0;
+            }
+        }
+    } else {
+        client->recv_pending = 0;
+        // 接收缓冲区池暂时用完时数据仍在套接字中，本批的缓冲区处理完就会归还，重新提交即可
+        if (!client->closing && event->result != -ENOBUFS) {
+            ok = client_received(client, event) == 0;
+        }
+        reactor_recycle(shard->reactor, event);
+        if (ok && !client->closing) {
+            ok = client_submit_recv(client) == 0;
+        }
+    }
+    if (!ok || client->closing) {
+        remove_client(shard, event->data);
+    }
+}
+
+static int64_t realtime_ns(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_REALTIME, &now);
+    return now.tv_sec * 1000000000LL + now.tv_nsec;
+}
+
+// 取得客户端所属机器人的图像缓存。机器人重连时旧连接可能还在本分片的客户端表中，
+// 按IP找到已经取得缓存的连接就不必经过所有分片共用的缓存锁；create 时没有则创建
+static FrameRing *robot_frames(ClientInfo *client, int create) {
+    SlotHandle handle = SLOT_HANDLE_NONE;
+    ClientInfo *other;
+    while ((other = slotmap_find(&client->shard->clients, client->ip_addr, handle, &handle)) != NULL) {
+        if (other->frames) {
+            return other->frames;
+        }
+    }
+    return frame_cache_get(&frame_cache, client->ip_addr, create);
+}
+
+// 缓存中有足够新的图像时不再向客户端请求，返回1
+static int use_cached_image(ClientInfo *client, int64_t max_age_ns) {
+    if (!client->frames) {
+        // 同一机器人之前的连接可能已经留下了图像
+        client->frames = robot_frames(client, 0);
+        if (!client->frames) {
+            return 0;
+        }
+    }
+    int64_t timestamp = frame_ring_timestamp(client->frames);
+    int64_t age = realtime_ns() - timestamp;
+    if (timestamp == 0 || age > max_age_ns) {
+        return 0;
+    }
+
+    char name[FRAME_CACHE_NAME_MAX + 16];
+    frame_cache_name(client->ip_addr, name, sizeof(name));
+    printf("使用缓存中 %.0f ms 前的图像，客户端: %s (共享内存 %s)\n", age / 1e6, client->ip_addr, name);
+    stat_add(&client->shard->stats.cache_hits, 1);
+    return 1;
+}
+
+// 向客户端发送推流命令前记下流控窗口，开始统计帧率
+static void stream_subscribed(ClientInfo *client, int window) {
+    if ((client->stream_window > 0) != (window > 0)) {
+        stat_add(&client->shard->stats.streams, window > 0 ? 1 : -1);
+    }
+    client->stream_window = window;
+    client->stream_outstanding = window;
+    client->stream_consumed = 0;
+    client->stream_frames = client->stream_bytes = 0;
+    clock_gettime(CLOCK_MONOTONIC, &client->stream_report);
+}
+
+// 把键盘线程投递的命令放入本分片所有客户端的出站队列，每条命令只编码一次
+void dispatch_commands(Shard *shard) {
+    OutItem *items = mailbox_take_all(&shard->mailbox);
+    if (!items) {
+        return;
+    }
+
+    SlotMap *clients = &shard->clients;
+    SlotHandle handle;
+    ClientInfo *client;
+    while (items) {
+        OutItem *item = items;
+        items = item->next;
+        for (uint32_t i = 0; (client = slotmap_at(clients, i, &handle)) != NULL; i++) {
+            if (item->msg->max_age_ns > 0 && use_cached_image(client, item->msg->max_age_ns)) {
+                continue;
+            }
+            if (item->msg->wire_type == WIRE_SUBSCRIBE) {
+                stream_subscribed(client, item->msg->stream_window);
+            }
+            client_send(client, item->msg);
+        }
+        outmsg_unref(item->msg);
+        free(item);
+    }
+
+    // 遍历时不能删除，先记下需要断开的客户端
+    SlotHandle *closing = NULL;
+    uint32_t closing_count = 0;
+    for (uint32_t i = 0; (client = slotmap_at(clients, i, &handle)) != NULL; i++) {
+        if (client->closing || update_client_interest(shard->reactor, client) < 0) {
+            if (!closing) {
+                closing = malloc(clients->count * sizeof(SlotHandle));
+                if (!closing) {
+                    break;
+                }
+            }
+            closing[closing_count++] = handle;
+        }
+    }
+
+    for (uint32_t i = 0; i < closing_count; i++) {
+        remove_client(shard, closing[i]);
+    }
+    free(closing);
+}
+
+// 处理缓冲区中所有完整的帧，返回-1表示协议错误
+int process_client_frames(ClientInfo *client) {
+    while (1) {
+        // 二进制帧的负载拷入写盘任务的缓冲区
+        if (client->image_remaining > 0) {
+            const char *data;
+            size_t n = frame_buffer_take(&client->rx, (size_t)client->image_remaining, &data);
+            if (n == 0) {
+                return 0;
+            }
+            receive_jpeg_image(client, data, n);
+            continue;
+        }
+
+        FrameHeader header;
+        const char *payload;
+        int ret = frame_buffer_next(&client->rx, &header, &payload);
+        if (ret <= 0) {
+            return ret;
+        }
+
+        if (header.type == FRAME_JSON) {
+            handle_client_message(client, payload, header.length);
+        } else if (header.type == FRAME_COMPACT) {
+            handle_client_compact(client, payload, header.length);
+        } else if (header.type == FRAME_BINARY) {
+            if (client->image_expected > 0) {
+                start_receive_jpeg_image(client, header.length);
+            } else {
+                if (client->image_expected == 0) {
+                    printf("丢弃未请求的二进制数据，客户端: %s\n", client->ip_addr);
+                }
+                client->image_size = client->image_remaining = header.length;
+            }
+            client->image_expected = 0;
+        } else {
+            printf("未知帧类型 %d，客户端: %s\n", header.type, client->ip_addr);
+            return -1;
+        }
+    }
+}
+
+// 读取客户端数据直到EAGAIN，返回-1表示连接已关闭
+int read_client(ClientInfo *client) {
+    int client_socket = client->socket;
+    int ret = 0;
+    while (1) {
+        ssize_t bytes_read;
+        if (client->image_remaining > 0) {
+            // 缓冲区已经取完，剩余图像数据直接收进写盘任务的缓冲区
+            bytes_read = recv_jpeg_image(client);
+            if (bytes_read > 0) {
+                continue;
+            }
+        } else {
+            bytes_read = frame_buffer_recv(&client->rx, client_socket);
+        }
+
+        if (bytes_read > 0) {
+            if (process_client_frames(client) < 0) {
+                printf("协议错误，断开客户端 %s\n", client->ip_addr);
+                ret = -1;
+                break;
+            }
+        } else if (bytes_read == 0) {
+            // 客户端断开连接
+            ret = -1;
+            break;
+        } else if (errno == EAGAIN || errno == EWOULDBLOCK) {
+            // 空闲连接不保留接收缓冲区
+            frame_buffer_shrink(&client->rx);
+            break;
+        } else if (errno != EINTR) {
+            // 接收错误
+            perror("receive data failed");
+            ret = -1;
+            break;
+        }
+    }
+    return ret;
+}
+
+// 开始接收客户端发送的JPEG图像，后续数据由 receive_jpeg_image/recv_jpeg_image 收进写盘任务
+int start_receive_jpeg_image(ClientInfo *client, long long size) {
+    client->image_size = client->image_remaining = size;
+    clock_gettime(CLOCK_MONOTONIC, &client->image_start);
+
+    // 预留不到内存时仍需读走图像数据
+    client->image = disk_job_create(&disk_writer, (size_t)size);
+    if (!client->image) {
+        printf("图像缓冲已满或图像过大，丢弃图像，客户端: %s\n", client->ip_addr);
+        return -1;
+    }
+    snprintf(client->image->robot, sizeof(client->image->robot), "%s", client->ip_addr);
+
+    if (!client->image_streamed) {
+        printf("正在接收图像数据，大小: %lld 字节\n", size);
+    }
+
+    if (size == 0) {
+        receive_jpeg_image(client, NULL, 0);
+    }
+    return 0;
+}
+
+// 收完一帧推流的图像：用掉半个窗口时归还额度，并定期打印这个客户端的持续帧率。
+// 内存不足而丢弃（stored 为0）的帧不计入帧率，但它用掉的额度仍要归还，否则推流会停住
+static void stream_frame_received(ClientInfo *client, int stored) {
+    if (stored) {
+        client->stream_frames++;
+        client->stream_bytes += client->image_size;
+        stat_add(&client->shard->stats.stream_frames, 1);
+    }
+
+    // 取消订阅后仍可能收到已在路上的帧，此时不再归还额度
+    if (client->stream_window > 0 && ++client->stream_consumed * 2 >= client->stream_window) {
+        OutMsg *msg = build_credit_command(client->stream_consumed);
+        if (msg) {
+            client_send(client, msg);
+            outmsg_unref(msg);
+        }
+        client->stream_outstanding += client->stream_consumed;
+        client->stream_consumed = 0;
+    }
+
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    double seconds = elapsed_ns(&client->stream_report, &now) / 1e9;
+    if (seconds >= STREAM_REPORT_INTERVAL) {
+        printf("推流 %s: %.1f fps, %.1f MB/s (最近 %.0f 秒)\n", client->ip_addr,
+               client->stream_frames / seconds, client->stream_bytes / seconds / 1e6, seconds);
+        client->stream_frames = client->stream_bytes = 0;
+        client->stream_report = now;
+    }
+}
+
+// 图像数据全部到达后把缓冲区交给写盘线程，并记录接收吞吐量；推流的帧不逐张打印
+static void finish_jpeg_image(ClientInfo *client) {
+    int streaming = client->image_streamed;
+    client->image_streamed = 0;
+    if (streaming) {
+        stream_frame_received(client, client->image != NULL);
+    }
+    if (!client->image) {
+        return;
+    }
+
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    double seconds = elapsed_ns(&client->image_start, &now) / 1e9;
+
+    // 放入共享内存缓存，供后续的 get_jpeg 和其他进程使用
+    if (!client->frames) {
+        client->frames = robot_frames(client, 1);
+    }
+    if (client->frames) {
+        frame_ring_publish(client->frames, client->image->data, client->image->size, realtime_ns());
+    }
+
+    client->image->quiet = streaming;
+    disk_writer_submit(&disk_writer, client->image);
+    client->image = NULL;
+    stat_add(&client->shard->stats.images, 1);
+
+    if (!streaming) {
+        printf("图像接收完成，客户端: %s (%.1f MB/s)\n", client->ip_addr,
+               seconds > 0 ? client->image_size / seconds / 1e6 : 0.0);
+    }
+}
+
+// 拷入重组缓冲区中已有的一段图像数据，返回消耗的字节数
+size_t receive_jpeg_image(ClientInfo *client, const char *data, size_t len) {
+    size_t n = len;
+    if ((long long)n > client->image_remaining) {
+        n = (size_t)client->image_remaining;
+    }
+
+    if (n > 0 && client->image) {
+        memcpy(client->image->data + (client->image_size - client->image_remaining), data, n);
+    }
+    client->image_remaining -= n;
+    stat_add(&client->shard->stats.bytes, n);
+
+    if (client->image_remaining == 0) {
+        finish_jpeg_image(client);
+    }
+
+    return n;
+}
+
+// 把套接字中剩余的图像数据直接收进写盘任务的缓冲区，返回值同 recv()
+ssize_t recv_jpeg_image(ClientInfo *client) {
+    struct timespec cpu_start, cpu_end;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &cpu_start);
+    ssize_t received;
+
+    if (client->image) {
+        received = recv(client->socket, client->image->data + (client->image_size - client->image_remaining),
+                        (size_t)client->image_remaining, 0);
+    } else {
+        // 丢弃未请求或放不下的数据
+        char discard[16384];
+        received = recv(client->socket, discard,
+                        (size_t)client->image_remaining < sizeof(discard) ? (size_t)client->image_remaining : sizeof(discard), 0);
+    }
+    if (received > 0) {
+        client->image_remaining -= received;
+        stat_add(&client->shard->stats.bytes, received);
+    }
+
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &cpu_end);
+    stat_add(&client->shard->stats.cpu_ns, elapsed_ns(&cpu_start, &cpu_end));
+
+    if (received > 0 && client->image_remaining == 0) {
+        finish_jpeg_image(client);
+    }
+    return received;
+}
+
+// 显示所有分片合计的图像接收统计
+void show_ingest_stats(void) {
+    IngestStats total = {0, 0, 0, 0, 0, 0};
+    for (int i = 0; i < shard_count; i++) {
+        total.images += __atomic_load_n(&shards[i].stats.images, __ATOMIC_RELAXED);
+        total.bytes += __atomic_load_n(&shards[i].stats.bytes, __ATOMIC_RELAXED);
+        total.cpu_ns += __atomic_load_n(&shards[i].stats.cpu_ns, __ATOMIC_RELAXED);
+        total.cache_hits += __atomic_load_n(&shards[i].stats.cache_hits, __ATOMIC_RELAXED);
+        total.stream_frames += __atomic_load_n(&shards[i].stats.stream_frames, __ATOMIC_RELAXED);
+        total.streams += __atomic_load_n(&shards[i].stats.streams, __ATOMIC_RELAXED);
+    }
+
+    double gb = total.bytes / 1e9;
+    printf("已接收图像: %lld 张, %.1f MB\n", total.images, total.bytes / 1e6);
+    if (gb > 0) {
+        printf("每GB数据的CPU时间: %.1f ms\n", total.cpu_ns / 1e6 / gb);
+    }
+
+    // 与上次显示之间的聚合接收速率，只由键盘线程调用
+    static IngestStats last;
+    static struct timespec last_time;
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    if (last_time.tv_sec != 0) {
+        double seconds = elapsed_ns(&last_time, &now) / 1e9;
+        printf("最近 %.1f 秒: %.1f 张/秒, %.1f MB/s, 其中推流 %.1f 帧/秒\n", seconds,
+               (total.images - last.images) / seconds, (total.bytes - last.bytes) / seconds / 1e6,
+               (total.stream_frames - last.stream_frames) / seconds);
+    }
+    last = total;
+    last_time = now;
+    printf("推流中的客户端: %lld, 共收到推流 %lld 帧\n", total.streams, total.stream_frames);
+    printf("图像缓存: %d 个机器人, 命中 %lld 次\n", __atomic_load_n(&frame_cache.rings, __ATOMIC_RELAXED), total.cache_hits);
+
+    DiskWriterStats disk;
+    disk_writer_stats(&disk_writer, &disk);
+    printf("已写盘: %lld 张, %.1f MB, 失败 %lld 张, 内存不足丢弃 %lld 张\n",
+           disk.written, disk.bytes / 1e6, disk.failed, disk.rejected);
+    printf("写盘队列: %d 张 (峰值 %d), 已预留 %.1f MB\n", disk.queued, disk.queued_max, disk.reserved / 1e6);
+    if (disk.batches > 0) {
+        printf("写盘延迟: 平均 %.2f ms, 最大 %.2f ms, 每批 %.1f 张\n",
+               disk.latency_ns_total / 1e6 / (disk.written + disk.failed), disk.latency_ns_max / 1e6,
+               (double)(disk.written + disk.failed) / disk.batches);
+    }
+
+    ImageStoreStats store;
+    image_store_stats(&image_store, &store);
+    printf("图像存储: %lld 张, %.1f MB, %d 个段, %d 个机器人\n",
+           store.images, store.bytes / 1e6, store.segments, store.robots);
+}
+
+// 处理初始化消息：记录客户端信息并回复上传地址
+static void client_init(ClientInfo *client, const char *reason, const char *rtsp_url, int compact) {
+    snprintf(client->reason, sizeof(client->reason), "%s", reason);
+    printf("Client %s (ID: %u):\n", client->ip_addr, (uint32_t)client->handle);
+    printf("reason: %s\n", client->reason);
+    if (rtsp_url) {
+        snprintf(client->rtsp_url, sizeof(client->rtsp_url), "%s", rtsp_url);
+        printf("rtsp_url: %s\n", client->rtsp_url);
+    }
+
+    // 回复仍使用 JSON，客户端收到同意后才切换到紧凑编码
+    OutMsg *msg = build_upload_url(SERVER_STREAM_UPLOAD_URL, compact);
+    if (msg) {
+        client_send(client, msg);
+        outmsg_unref(msg);
+        printf("responese upload url: %s%s\n", SERVER_STREAM_UPLOAD_URL, compact ? " (compact)" : "");
+    }
+    client->compact = compact;
+}
+
+// 图像数据在随后的二进制帧中
+static void expect_jpeg_image(ClientInfo *client, long long size, int streamed) {
+    // 只有订阅中、且在已发放额度之内的推流帧才计入推流并归还额度；
+    // 其余标为推流的帧（未订阅、停止后仍在途中或超出额度）读走丢弃
+    client->image_streamed = streamed && client->stream_window > 0 && client->stream_outstanding > 0;
+    if (client->image_streamed) {
+        client->stream_outstanding--;
+    } else if (streamed) {
+        printf("丢弃未订阅或超出流控额度的推流图像，客户端: %s\n", client->ip_addr);
+    } else {
+        printf("接收到图像响应，客户端: %s\n", client->ip_addr);
+        printf("图像大小: %lld 字节\n", size);
+    }
+    int wanted = !streamed || client->image_streamed;
+
+    if (client->rx.mode == FRAME_MODE_UNFRAMED) {
+        // 旧协议没有二进制帧头，图像数据紧跟在图像头之后
+        if (size >= 0 && wanted) {
+            start_receive_jpeg_image(client, size);
+        } else if (size >= 0) {
+            client->image_size = client->image_remaining = size;
+        }
+        return;
+    }
+    client->image_expected = wanted ? 1 : -1;
+}
+
+// 处理一条解码后的客户端消息，JSON 和紧凑编码的消息都转换为 WireMessage
+static void dispatch_client_message(ClientInfo *client, const WireMessage *msg) {
+    switch (msg->type) {
+        case WIRE_INIT:
+            client_init(client, msg->init.reason, WIRE_HAS(msg, WIRE_FIELD_URL) ? msg->init.url : NULL,
+                        msg->init.compact);
+            break;
+        case WIRE_STATUS:
+            printf("\nClient %s status: %s battery: %lld is_moving: %d position: %s\n",
+                   client->ip_addr, msg->status.status, (long long)msg->status.battery,
+                   msg->status.is_moving, msg->status.position);
+            break;
+        case WIRE_JPEG_IMAGE:
+            expect_jpeg_image(client, (long long)msg->jpeg_image.size, msg->jpeg_image.stream);
+            break;
+        default:
+            printf("未知消息类型 %d，客户端: %s\n", msg->type, client->ip_addr);
+            break;
+    }
+}
+
+// 处理一条客户端消息；按需解析并按 wire_messages.def 校验字段，分发过程不分配内存
+void handle_client_message(ClientInfo *client, const char *buffer, size_t len) {
+    WireMessage msg;
+    if (wire_decode_json(&msg, buffer, len) < 0) {
+        printf("无法解析消息，客户端: %s\n", client->ip_addr);
+        return;
+    }
+    if (msg.type != WIRE_JPEG_IMAGE || !msg.jpeg_image.stream) {
+        printf("\n%.*s\n", (int)len, buffer);
+    }
+    if (msg.type != 0) {
+        dispatch_client_message(client, &msg);
+    }
+}
+
+// 处理一条紧凑编码的客户端消息
+void handle_client_compact(ClientInfo *client, const char *buffer, size_t len) {
+    WireMessage msg;
+    if (wire_decode(&msg, (const uint8_t *)buffer, len) < 0) {
+        printf("无法解析紧凑消息，客户端: %s\n", client->ip_addr);
+        return;
+    }
+    if (msg.type == WIRE_INIT) {
+        // 能发送紧凑消息的客户端一定支持紧凑编码
+        msg.init.compact = 1;
+    }
+    dispatch_client_message(client, &msg);
+}
+
+// 广播线程函数
+void *broadcast_thread(void *arg) {
+    int broadcast_sock;
+    struct sockaddr_in broadcast_addr;
+    int broadcast_enable = 1;
+    char broadcast_message[256];
+    
+    // 创建UDP套接字
+    if ((broadcast_sock = socket(AF_INET, SOCK_DGRAM, 0)) < 0) {
+        perror("broadcast socket create failed");
+        return NULL;
+    }
+    
+    // 设置广播选项
+    if (setsockopt(broadcast_sock, SOL_SOCKET, SO_BROADCAST, &broadcast_enable, sizeof(broadcast_enable)) < 0) {
+        perror("set broadcast option failed");
+        close(broadcast_sock);
+        return NULL;
+    }
+    
+    // 设置广播地址
+    memset(&broadcast_addr, 0, sizeof(broadcast_addr));
+    broadcast_addr.sin_family = AF_INET;
+    broadcast_addr.sin_port = htons(BROADCAST_PORT);
+    broadcast_addr.sin_addr.s_addr = inet_addr("255.255.255.255");  // 广播地址
+    
+    // 获取本机IP地址
+    char host_ip[INET_ADDRSTRLEN];
+    struct sockaddr_in host_addr;
+    socklen_t host_len = sizeof(host_addr);
+    
+    // 创建一个临时套接字来获取本机IP
+    int temp_sock = socket(AF_INET, SOCK_DGRAM, 0);
+    if (temp_sock < 0) {
+        perror("temp socket create failed");
+        close(broadcast_sock);
+        return NULL;
+    }
+    
+    // 连接到一个外部地址（不会真正发送数据）
+    memset(&host_addr, 0, sizeof(host_addr));
+    host_addr.sin_family = AF_INET;
+    host_addr.sin_port = htons(80);
+    host_addr.sin_addr.s_addr = inet_addr("8.8.8.8");  // 谷歌DNS服务器
+    
+    if (connect(temp_sock, (struct sockaddr*)&host_addr, sizeof(host_addr)) < 0) {
+        perror("temp connect failed");
+        close(temp_sock);
+        close(broadcast_sock);
+        return NULL;
+    }
+    
+    // 获取本机地址
+    if (getsockname(temp_sock, (struct sockaddr*)&host_addr, &host_len) < 0) {
+        perror("get local ip failed");
+        close(temp_sock);
+        close(broadcast_sock);
+        return NULL;
+    }
+    
+    inet_ntop(AF_INET, &host_addr.sin_addr, host_ip, INET_ADDRSTRLEN);
+    close(temp_sock);
+    
+    printf("server ip: %s\n", host_ip);
+    
+    // 准备广播消息
+    snprintf(broadcast_message, sizeof(broadcast_message), 
+             "{\"server_ip\":\"%s\",\"server_port\":%d}", 
+             host_ip, PORT);
+    
+    // 广播循环
+    while (1) {
+        if (sendto(broadcast_sock, broadcast_message, strlen(broadcast_message), 0,
+                  (struct sockaddr*)&broadcast_addr, sizeof(broadcast_addr)) < 0) {
+            perror("broadcast send failed");
+        } else {
+            printf("Broadcast message: %s\n", broadcast_message);
+        }
+        
+        sleep(BROADCAST_INTERVAL);
+    }
+    
+    close(broadcast_sock);
+    return NULL;
+}
+
+// 提高文件描述符上限，每个客户端只占用一个套接字；图像收在内存中，由写盘线程追加到共用的段文件，
+// 另外只需少量固定的描述符（监听套接字、事件循环、图像存储的段和索引文件）
+void raise_fd_limit(rlim_t wanted) {
+    struct rlimit limit;
+    if (getrlimit(RLIMIT_NOFILE, &limit) < 0) {
+        return;
+    }
+    if (limit.rlim_cur < wanted) {
+        limit.rlim_cur = wanted < limit.rlim_max ? wanted : limit.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &limit);
+    }
+}
+
+// 创建监听套接字；reuseport 时多个分片各自绑定同一端口，由内核把新连接分到各个监听队列
+int create_listener(int backlog, int reuseport) {
+    int server_fd;
+    struct sockaddr_in address;
+    int opt = 1;
+
+    // 创建套接字
+    if ((server_fd = socket(AF_INET, SOCK_STREAM, 0)) < 0) {
+        perror("socket failed");
+        return -1;
+    }
+
+    // 设置套接字选项
+    if (setsockopt(server_fd, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt))) {
+        perror("setsockopt");
+        close(server_fd);
+        return -1;
+    }
+#ifdef SO_REUSEPORT
+    if (reuseport && setsockopt(server_fd, SOL_SOCKET, SO_REUSEPORT, &opt, sizeof(opt))) {
+        perror("setsockopt SO_REUSEPORT");
+        close(server_fd);
+        return -1;
+    }
+#else
+    (void)reuseport;
+#endif
+
+    memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = INADDR_ANY;
+    address.sin_port = htons(PORT);
+
+    // 绑定套接字
+    if (bind(server_fd, (struct sockaddr *)&address, sizeof(address)) < 0) {
+        perror("bind failed");
+        close(server_fd);
+        return -1;
+    }
+
+    // 监听连接，重连风暴时需要足够大的队列容纳同时到达的SYN
+    if (listen(server_fd, backlog) < 0 || set_socket_nonblocking(server_fd) < 0) {
+        perror("listen");
+        close(server_fd);
+        return -1;
+    }
+    return server_fd;
+}
+
+// 初始化分片的客户端表、邮箱和事件循环，并注册监听套接字
+int shard_init(Shard *shard, int id, int listen_fd, uint32_t max_clients) {
+    shard->id = id;
+    shard->listen_fd = listen_fd;
+    if (slotmap_init(&shard->clients, sizeof(ClientInfo), max_clients) < 0) {
+        perror("create client table failed");
+        return -1;
+    }
+    if (mailbox_init(&shard->mailbox) < 0) {
+        perror("create command mailbox failed");
+        return -1;
+    }
+    shard->reactor = reactor_create();
+    if (!shard->reactor) {
+        perror("create reactor failed");
+        return -1;
+    }
+    shard->completions = reactor_completions(shard->reactor);
+    if (shard->completions) {
+        // 完成模式下由内核代为等待新连接，监听套接字保持阻塞模式
+        int flags = fcntl(listen_fd, F_GETFL, 0);
+        if (flags < 0 || fcntl(listen_fd, F_SETFL, flags & ~O_NONBLOCK) < 0) {
+            perror("set server socket blocking failed");
+            return -1;
+        }
+        shard_submit_accepts(shard);
+        if (shard->accepts == 0) {
+            perror("submit accept failed");
+            return -1;
+        }
+    } else if (reactor_add(shard->reactor, listen_fd, REACTOR_READ, TOKEN_LISTENER) < 0) {
+        perror("register server socket failed");
+        return -1;
+    }
+    if (reactor_add(shard->reactor, shard->mailbox.wake_fd[0], REACTOR_READ, TOKEN_MAILBOX) < 0) {
+        perror("register command mailbox failed");
+        return -1;
+    }
+    return 0;
+}
+
+// 分片的事件循环：接受连接、读取数据并分发消息；完成模式下处理 accept/recv/send 的完成事件
+void *shard_thread(void *arg) {
+    Shard *shard = arg;
+    ReactorEvent events[MAX_EVENTS];
+    while (!__atomic_load_n(&server_stopping, __ATOMIC_ACQUIRE)) {
+        int n = reactor_wait(shard->reactor, events, MAX_EVENTS, -1);
+        if (n < 0) {
+            perror("reactor wait failed");
+            break;
+        }
+
+        for (int i = 0; i < n; i++) {
+            if (events[i].data == TOKEN_LISTENER) {
+                if (events[i].events & REACTOR_ACCEPTED) {
+                    client_accepted(shard, &events[i]);
+                } else {
+                    accept_clients(shard);
+                }
+            } else if (events[i].data == TOKEN_MAILBOX) {
+                dispatch_commands(shard);
+            } else if (events[i].events & (REACTOR_RECEIVED | REACTOR_SENT)) {
+                complete_client(shard, &events[i]);
+            } else {
+                service_client(shard, events[i].data, events[i].events);
+            }
+        }
+    }
+    return NULL;
+}
+
+void usage(const char *prog) {
+    printf("usage: %s [-t 事件循环线程数] [-b 监听队列长度] [-w 写盘线程数] [-s] [-r 保留小时数] [-a 毫秒]\n", prog);
+    printf("  -s  图像写入后 fsync（按批组提交）\n");
+    printf("  -r  只保留最近若干小时的图像，按整段删除；0 表示不删除（默认）\n");
+    printf("  -a  j 命令使用不超过该时间的缓存图像，默认 %d；0 表示总是重新获取\n", JPEG_MAX_AGE_MS);
+}
+
+int main(int argc, char *argv[]) {
+    // 默认每个CPU一个事件循环线程
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    int threads = cpus > 0 ? (int)cpus : 1;
+    int backlog = SOMAXCONN;
+    int writer_threads = DISK_WRITER_THREADS;
+    int sync = 0;
+    double retention_hours = 0;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "t:b:w:sr:a:h")) != -1) {
+        switch (opt) {
+            case 't':
+                threads = atoi(optarg);
+                break;
+            case 'b':
+                backlog = atoi(optarg);
+                break;
+            case 'w':
+                writer_threads = atoi(optarg);
+                break;
+            case 's':
+                sync = 1;
+                break;
+            case 'r':
+                retention_hours = atof(optarg);
+                break;
+            case 'a':
+                jpeg_max_age_ns = atoll(optarg) * 1000000LL;
+                break;
+            default:
+                usage(argv[0]);
+                exit(opt == 'h' ? EXIT_SUCCESS : EXIT_FAILURE);
+        }
+    }
+    if (threads < 1) {
+        threads = 1;
+    } else if (threads > MAX_SHARDS) {
+        threads = MAX_SHARDS;
+    }
+    if (backlog < 1) {
+        backlog = SOMAXCONN;
+    }
+    if (writer_threads < 1) {
+        writer_threads = 1;
+    }
+
+    // 没有 SO_REUSEPORT 负载均衡的平台上所有分片共用一个监听套接字
+    int reuseport = 0;
+#if defined(__linux__) && defined(SO_REUSEPORT)
+    reuseport = threads > 1;
+#endif
+
+    shards = calloc(threads, sizeof(Shard));
+    if (!shards) {
+        perror("create shards failed");
+        exit(EXIT_FAILURE);
+    }
+    raise_fd_limit(MAX_CLIENTS + 64);
+
+    uint32_t shard_clients = (MAX_CLIENTS + threads - 1) / threads;
+    for (int i = 0; i < threads; i++) {
+        int listen_fd = (i == 0 || reuseport) ? create_listener(backlog, reuseport) : shards[0].listen_fd;
+        if (listen_fd < 0 || shard_init(&shards[i], i, listen_fd, shard_clients) < 0) {
+            exit(EXIT_FAILURE);
+        }
+        shard_count++;
+    }
+
+    if (jpeg_max_age_ns < 0) {
+        jpeg_max_age_ns = 0;
+    }
+    if (retention_hours < 0) {
+        retention_hours = 0;
+    }
+    frame_cache_init(&frame_cache, FRAME_CACHE_SLOTS, FRAME_CACHE_SLOT_BYTES);
+    if (image_store_open(&image_store, IMAGE_DIR, IMAGE_SEGMENT_BYTES, (int64_t)(retention_hours * 3600e9)) < 0 ||
+        disk_writer_start(&disk_writer, &image_store, writer_threads, IMAGE_QUEUE_BYTES, sync) < 0) {
+        exit(EXIT_FAILURE);
+    }
+
+    printf("server start, listen port %d\n", PORT);
+    printf("event backend: %s%s, %d threads, backlog %d%s\n", reactor_backend(shards[0].reactor),
+           shards[0].completions ? " (completions)" : "", shard_count, backlog, reuseport ? ", SO_REUSEPORT" : "");
+    printf("disk writer: %d threads%s\n", writer_threads, sync ? ", fsync" : "");
+    ImageStoreStats store;
+    image_store_stats(&image_store, &store);
+    printf("image store: %s, %lld images in %d segments\n", IMAGE_DIR, store.images, store.segments);
+
+    // 创建键盘输入线程
+    pthread_t kb_thread;
+    if (pthread_create(&kb_thread, NULL, keyboard_thread, NULL) != 0) {
+        perror("create keyboard thread failed");
+        exit(EXIT_FAILURE);
+    }
+    
+    // 在main函数中创建广播线程
+    pthread_t bc_thread;
+    if (pthread_create(&bc_thread, NULL, broadcast_thread, NULL) != 0) {
+        perror("create broadcast thread failed");
+        // 继续运行，不退出
+    }
+
+    // 分片0在主线程中运行
+    for (int i = 1; i < shard_count; i++) {
+        if (pthread_create(&shards[i].thread, NULL, shard_thread, &shards[i]) != 0) {
+            perror("create event loop thread failed");
+            exit(EXIT_FAILURE);
+        }
+    }
+    shard_thread(&shards[0]);
+    for (int i = 1; i < shard_count; i++) {
+        pthread_join(shards[i].thread, NULL);
+    }
+
+    // 清理：所有事件循环已退出，写完已收到的图像
+    for (int i = 0; i < shard_count; i++) {
+        reactor_destroy(shards[i].reactor);
+        if (i == 0 || shards[i].listen_fd != shards[0].listen_fd) {
+            close(shards[i].listen_fd);
+        }
+    }
+    disk_writer_stop(&disk_writer);
+    image_store_close(&image_store);
+    frame_cache_close(&frame_cache);
+
+    return 0;
+}
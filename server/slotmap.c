@@ -0,0 +1,216 @@
+#include <stdlib.h>
+#include <string.h>
+#include "slotmap.h"
+
+#define SLOT_PAGE_SHIFT 10
+#define SLOT_PAGE_SIZE (1u << SLOT_PAGE_SHIFT)  // 每页槽位数
+#define SLOT_NONE 0xFFFFFFFFu
+#define SLOT_GENERATION_MASK 0x7FFFFFFFu
+
+typedef struct {
+    uint32_t generation;  // 槽位释放时加一
+    uint32_t in_use;
+    uint32_t dense_pos;   // 在 dense 数组中的位置
+    uint32_t next;        // 空闲链表或哈希链的下一个槽位
+    uint32_t hash;
+    char key[SLOT_KEY_SIZE];
+} SlotHeader;
+
+// 槽位头按16字节对齐，保证值的对齐
+#define SLOT_HEADER_SIZE ((sizeof(SlotHeader) + 15) & ~(size_t)15)
+
+static uint32_t hash_key(const char *key) {
+    // FNV-1a
+    uint32_t h = 2166136261u;
+    while (*key) {
+        h ^= (uint8_t)*key++;
+        h *= 16777619u;
+    }
+    return h;
+}
+
+static SlotHeader *slot_at(SlotMap *map, uint32_t index) {
+    return (SlotHeader *)(map->pages[index >> SLOT_PAGE_SHIFT] +
+                          (size_t)(index & (SLOT_PAGE_SIZE - 1)) * map->slot_size);
+}
+
+static void *slot_value(SlotHeader *slot) {
+    return (char *)slot + SLOT_HEADER_SIZE;
+}
+
+static SlotHandle make_handle(SlotHeader *slot, uint32_t index) {
+    return ((SlotHandle)slot->generation << 32) | index;
+}
+
+int slotmap_init(SlotMap *map, size_t value_size, uint32_t max_entries) {
+    memset(map, 0, sizeof(*map));
+    map->value_size = value_size;
+    map->slot_size = SLOT_HEADER_SIZE + ((value_size + 15) & ~(size_t)15);
+    map->max_entries = max_entries;
+    map->free_head = SLOT_NONE;
+
+    uint32_t page_count = (max_entries + SLOT_PAGE_SIZE - 1) / SLOT_PAGE_SIZE;
+    map->pages = calloc(page_count, sizeof(char *));
+
+    // 哈希桶数取不小于 max_entries 的2的幂，负载因子不超过1
+    uint32_t buckets = 16;
+    while (buckets < max_entries) {
+        buckets <<= 1;
+    }
+    map->buckets = malloc(buckets * sizeof(uint32_t));
+    if (!map->pages || !map->buckets) {
+        slotmap_free(map);
+        return -1;
+    }
+    memset(map->buckets, 0xFF, buckets * sizeof(uint32_t));
+    map->bucket_mask = buckets - 1;
+    return 0;
+}
+
+void slotmap_free(SlotMap *map) {
+    for (uint32_t i = 0; i < map->page_count; i++) {
+        free(map->pages[i]);
+    }
+    free(map->pages);
+    free(map->dense);
+    free(map->buckets);
+    memset(map, 0, sizeof(*map));
+}
+
+// 新增一页槽位并放入空闲链表
+static int slotmap_grow(SlotMap *map) {
+    if (map->capacity >= map->max_entries) {
+        return -1;
+    }
+    char *page = calloc(SLOT_PAGE_SIZE, map->slot_size);
+    if (!page) {
+        return -1;
+    }
+    map->pages[map->page_count++] = page;
+
+    uint32_t first = map->capacity;
+    uint32_t last = first + SLOT_PAGE_SIZE;
+    if (last > map->max_entries) {
+        last = map->max_entries;
+    }
+    for (uint32_t i = last; i-- > first;) {
+        SlotHeader *slot = slot_at(map, i);
+        slot->generation = 1;
+        slot->next = map->free_head;
+        map->free_head = i;
+    }
+    map->capacity = last;
+    return 0;
+}
+
+void *slotmap_insert(SlotMap *map, const char *key, SlotHandle *handle) {
+    if (map->free_head == SLOT_NONE && slotmap_grow(map) < 0) {
+        return NULL;
+    }
+    if (map->count == map->dense_capacity) {
+        uint32_t capacity = map->dense_capacity ? map->dense_capacity * 2 : 64;
+        uint32_t *dense = realloc(map->dense, capacity * sizeof(uint32_t));
+        if (!dense) {
+            return NULL;
+        }
+        map->dense = dense;
+        map->dense_capacity = capacity;
+    }
+
+    uint32_t index = map->free_head;
+    SlotHeader *slot = slot_at(map, index);
+    map->free_head = slot->next;
+
+    slot->in_use = 1;
+    slot->dense_pos = map->count;
+    map->dense[map->count++] = index;
+
+    strncpy(slot->key, key, SLOT_KEY_SIZE - 1);
+    slot->key[SLOT_KEY_SIZE - 1] = '\0';
+    slot->hash = hash_key(slot->key);
+    uint32_t *bucket = &map->buckets[slot->hash & map->bucket_mask];
+    slot->next = *bucket;
+    *bucket = index;
+
+    memset(slot_value(slot), 0, map->value_size);
+    *handle = make_handle(slot, index);
+    return slot_value(slot);
+}
+
+static SlotHeader *slotmap_lookup(SlotMap *map, SlotHandle handle) {
+    uint32_t index = (uint32_t)handle;
+    if (handle == SLOT_HANDLE_NONE || index >= map->capacity) {
+        return NULL;
+    }
+    SlotHeader *slot = slot_at(map, index);
+    if (!slot->in_use || slot->generation != (uint32_t)(handle >> 32)) {
+        return NULL;
+    }
+    return slot;
+}
+
+void *slotmap_get(SlotMap *map, SlotHandle handle) {
+    SlotHeader *slot = slotmap_lookup(map, handle);
+    return slot ? slot_value(slot) : NULL;
+}
+
+void slotmap_remove(SlotMap *map, SlotHandle handle) {
+    SlotHeader *slot = slotmap_lookup(map, handle);
+    if (!slot) {
+        return;
+    }
+    uint32_t index = (uint32_t)handle;
+
+    // 从哈希链中摘除
+    uint32_t *link = &map->buckets[slot->hash & map->bucket_mask];
+    while (*link != index) {
+        link = &slot_at(map, *link)->next;
+    }
+    *link = slot->next;
+
+    // 用 dense 数组末尾的槽位填补空位
+    uint32_t last = map->dense[--map->count];
+    map->dense[slot->dense_pos] = last;
+    slot_at(map, last)->dense_pos = slot->dense_pos;
+
+    slot->in_use = 0;
+    slot->generation = (slot->generation + 1) & SLOT_GENERATION_MASK;
+    if (slot->generation == 0) {
+        slot->generation = 1;
+    }
+    slot->next = map->free_head;
+    map->free_head = index;
+}
+
+void *slotmap_at(SlotMap *map, uint32_t i, SlotHandle *handle) {
+    if (i >= map->count) {
+        return NULL;
+    }
+    uint32_t index = map->dense[i];
+    SlotHeader *slot = slot_at(map, index);
+    *handle = make_handle(slot, index);
+    return slot_value(slot);
+}
+
+void *slotmap_find(SlotMap *map, const char *key, SlotHandle after, SlotHandle *handle) {
+    uint32_t index;
+    if (after == SLOT_HANDLE_NONE) {
+        index = map->buckets[hash_key(key) & map->bucket_mask];
+    } else {
+        SlotHeader *prev = slotmap_lookup(map, after);
+        if (!prev) {
+            return NULL;
+        }
+        index = prev->next;
+    }
+
+    while (index != SLOT_NONE) {
+        SlotHeader *slot = slot_at(map, index);
+        if (strncmp(slot->key, key, SLOT_KEY_SIZE - 1) == 0) {
+            *handle = make_handle(slot, index);
+            return slot_value(slot);
+        }
+        index = slot->next;
+    }
+    return NULL;
+}
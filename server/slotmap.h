@@ -0,0 +1,40 @@
+#ifndef SLOTMAP_H
+#define SLOTMAP_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// 句柄：高32位为代数，低32位为槽位下标。槽位被释放后代数加一，旧句柄随即失效。
+// 0 不是有效句柄，最高位保留给调用方做标记。
+typedef uint64_t SlotHandle;
+#define SLOT_HANDLE_NONE 0
+#define SLOT_KEY_SIZE 48
+
+typedef struct {
+    size_t value_size;
+    size_t slot_size;
+    uint32_t max_entries;
+    char **pages;        // 槽位按页分配，已分配的槽位地址不会改变
+    uint32_t page_count;
+    uint32_t capacity;   // 已分配的槽位数
+    uint32_t free_head;  // 空闲槽位链表
+    uint32_t *dense;     // 已使用槽位的紧凑数组，用于遍历
+    uint32_t count;
+    uint32_t dense_capacity;
+    uint32_t *buckets;   // 按键的哈希索引，链表串接同一桶内的槽位
+    uint32_t bucket_mask;
+} SlotMap;
+
+int slotmap_init(SlotMap *map, size_t value_size, uint32_t max_entries);
+void slotmap_free(SlotMap *map);
+// 分配一个清零的槽位并按 key 建立索引，已满时返回 NULL
+void *slotmap_insert(SlotMap *map, const char *key, SlotHandle *handle);
+// 句柄已失效时返回 NULL
+void *slotmap_get(SlotMap *map, SlotHandle handle);
+void slotmap_remove(SlotMap *map, SlotHandle handle);
+// 按下标遍历已使用的槽位，i 取 [0, count)；遍历时不能删除
+void *slotmap_at(SlotMap *map, uint32_t i, SlotHandle *handle);
+// 查找 key 对应的槽位，after 为上一次的结果（首次传 SLOT_HANDLE_NONE），可遍历同一 key 的多个槽位
+void *slotmap_find(SlotMap *map, const char *key, SlotHandle after, SlotHandle *handle);
+
+#endif
@@ -0,0 +1,266 @@
+// 图像存储基准：对比每张图像一个文件的目录布局和分段图像存储（image_store.h）的
+// 写入吞吐（张/秒、MB/秒）和按时间范围查询的延迟。通过 make bench 编译运行。
+//
+// 用法：./store_bench [-n 图像数] [-k 图像KB] [-r 机器人数] [-q 查询次数] [-s]
+// -s 时两种布局都按批组提交：每 16 张 fsync 一次，与写盘线程相同。
+// 查询为随机机器人、随机起点、覆盖总时间跨度 1% 的时间窗口，
+// 文件布局需要扫描目录并解析文件名，存储只需在内存索引中二分查找。
+// 数据在运行目录下的临时目录中，结束后删除；结果受页缓存影响，不代表冷读性能。
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <dirent.h>
+#include <time.h>
+#include <sys/stat.h>
+#include "image_store.h"
+
+#define BATCH 16                     // 与 DISK_BATCH_MAX 相同
+#define FRAME_INTERVAL_NS 1000000LL  // 相邻两张图像的时间间隔
+#define MAX_RESULTS 4096
+
+static double now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static void robot_name(int robot, char *name, size_t size) {
+    snprintf(name, size, "10.0.%d.%d", robot / 256, robot % 256);
+}
+
+// 文件布局的文件名：机器人_纳秒时间戳.jpg，时间戳带纳秒以免同一秒内互相覆盖
+static void file_path(const char *dir, const char *robot, int64_t timestamp, char *path, size_t size) {
+    snprintf(path, size, "%s/%s_%lld.jpg", dir, robot, (long long)timestamp);
+}
+
+static void sync_dir(const char *dir) {
+    int fd = open(dir, O_RDONLY | O_DIRECTORY);
+    if (fd >= 0) {
+        fsync(fd);
+        close(fd);
+    }
+}
+
+static double ingest_files(const char *dir, int images, int robots, const char *data, size_t size,
+                           int64_t base, int sync) {
+    int fds[BATCH];
+    int pending = 0;
+    double start = now_ns();
+    for (int i = 0; i < images; i++) {
+        char robot[STORE_ROBOT_MAX], path[512];
+        robot_name(i % robots, robot, sizeof(robot));
+        file_path(dir, robot, base + i * FRAME_INTERVAL_NS, path, sizeof(path));
+        int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (fd < 0 || write(fd, data, size) != (ssize_t)size) {
+            perror(path);
+            exit(EXIT_FAILURE);
+        }
+        fds[pending++] = fd;
+        if (pending == BATCH || i == images - 1) {
+            for (int j = 0; j < pending; j++) {
+                if (sync) {
+                    fsync(fds[j]);
+                }
+                close(fds[j]);
+            }
+            if (sync) {
+                sync_dir(dir);
+            }
+            pending = 0;
+        }
+    }
+    return now_ns() - start;
+}
+
+static double ingest_store(ImageStore *store, int images, int robots, const char *data, size_t size,
+                           int64_t base, int sync) {
+    double start = now_ns();
+    for (int i = 0; i < images; i++) {
+        char robot[STORE_ROBOT_MAX];
+        robot_name(i % robots, robot, sizeof(robot));
+        if (image_store_append(store, robot, base + i * FRAME_INTERVAL_NS, data, size, NULL) < 0) {
+            fprintf(stderr, "追加图像失败\n");
+            exit(EXIT_FAILURE);
+        }
+        if ((i + 1) % BATCH == 0 || i == images - 1) {
+            image_store_commit(store, sync);
+        }
+    }
+    return now_ns() - start;
+}
+
+// 扫描目录，统计文件名中机器人和时间戳都在范围内的图像，read 时读出这些文件
+static size_t query_files(const char *dir, const char *robot, int64_t from, int64_t to, char *buffer, int read_data) {
+    size_t found = 0;
+    size_t robot_len = strlen(robot);
+    DIR *d = opendir(dir);
+    struct dirent *ent;
+    while ((ent = readdir(d)) != NULL) {
+        if (strncmp(ent->d_name, robot, robot_len) != 0 || ent->d_name[robot_len] != '_') {
+            continue;
+        }
+        long long timestamp = strtoll(ent->d_name + robot_len + 1, NULL, 10);
+        if (timestamp < from || timestamp >= to) {
+            continue;
+        }
+        found++;
+        if (read_data) {
+            char path[512];
+            snprintf(path, sizeof(path), "%s/%s", dir, ent->d_name);
+            int fd = open(path, O_RDONLY);
+            if (fd >= 0) {
+                while (read(fd, buffer, 1 << 20) > 0) {
+                }
+                close(fd);
+            }
+        }
+    }
+    closedir(d);
+    return found;
+}
+
+static size_t query_store(ImageStore *store, const char *robot, int64_t from, int64_t to, char *buffer, int read_data) {
+    static StoreEntry entries[MAX_RESULTS];
+    size_t found = image_store_query(store, robot, from, to, entries, MAX_RESULTS);
+    if (read_data) {
+        for (size_t i = 0; i < found && i < MAX_RESULTS; i++) {
+            image_store_read(store, &entries[i], buffer);
+        }
+    }
+    return found;
+}
+
+static void remove_dir(const char *dir) {
+    DIR *d = opendir(dir);
+    if (!d) {
+        return;
+    }
+    struct dirent *ent;
+    while ((ent = readdir(d)) != NULL) {
+        if (ent->d_name[0] != '.') {
+            char path[512];
+            snprintf(path, sizeof(path), "%s/%s", dir, ent->d_name);
+            unlink(path);
+        }
+    }
+    closedir(d);
+    rmdir(dir);
+}
+
+static void print_ingest(const char *name, double elapsed, int images, size_t size) {
+    printf("%-22s %12.0f %10.1f\n", name, images / elapsed * 1e9, (double)images * size / elapsed * 1e3);
+}
+
+static void print_query(const char *name, double elapsed, int queries, size_t found) {
+    printf("%-22s %12.1f %10.1f\n", name, elapsed / queries / 1e3, (double)found / queries);
+}
+
+int main(int argc, char *argv[]) {
+    int images = 20000;
+    int kb = 32;
+    int robots = 8;
+    int queries = 200;
+    int sync = 0;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "n:k:r:q:s")) != -1) {
+        switch (opt) {
+            case 'n':
+                images = atoi(optarg);
+                break;
+            case 'k':
+                kb = atoi(optarg);
+                break;
+            case 'r':
+                robots = atoi(optarg);
+                break;
+            case 'q':
+                queries = atoi(optarg);
+                break;
+            case 's':
+                sync = 1;
+                break;
+            default:
+                fprintf(stderr, "用法: %s [-n 图像数] [-k 图像KB] [-r 机器人数] [-q 查询次数] [-s]\n", argv[0]);
+                return 1;
+        }
+    }
+    if (images <= 0 || kb <= 0 || robots <= 0 || robots > 65536 || queries <= 0) {
+        fprintf(stderr, "参数无效\n");
+        return 1;
+    }
+
+    size_t size = (size_t)kb * 1024;
+    char *data = malloc(size);
+    char *buffer = malloc(size > (1 << 20) ? size : (1 << 20));
+    if (!data || !buffer) {
+        return 1;
+    }
+    for (size_t i = 0; i < size; i++) {
+        data[i] = (char)(i * 131 + 7);
+    }
+
+    char files_dir[] = "store_bench_files.XXXXXX";
+    char store_dir[] = "store_bench_store.XXXXXX";
+    if (!mkdtemp(files_dir) || !mkdtemp(store_dir)) {
+        perror("mkdtemp");
+        return 1;
+    }
+
+    int64_t base = 1700000000LL * 1000000000LL;
+    int64_t span = images * FRAME_INTERVAL_NS;
+    int64_t window = span / 100 > 0 ? span / 100 : 1;
+
+    printf("%d 张图像，每张 %d KB，%d 个机器人%s；%d 次查询，窗口为总时间跨度的 1%%\n\n",
+           images, kb, robots, sync ? "，组提交 fsync" : "", queries);
+    printf("%-22s %12s %10s\n", "ingest", "images/s", "MB/s");
+
+    double files_elapsed = ingest_files(files_dir, images, robots, data, size, base, sync);
+    print_ingest("per-file", files_elapsed, images, size);
+
+    ImageStore store;
+    if (image_store_open(&store, store_dir, 256ULL * 1024 * 1024, 0) < 0) {
+        return 1;
+    }
+    double store_elapsed = ingest_store(&store, images, robots, data, size, base, sync);
+    print_ingest("image_store", store_elapsed, images, size);
+
+    // 重新打开，计入启动时加载索引的耗时
+    image_store_close(&store);
+    double start = now_ns();
+    image_store_open(&store, store_dir, 256ULL * 1024 * 1024, 0);
+    double load_elapsed = now_ns() - start;
+
+    printf("\n%-22s %12s %10s\n", "range query", "us/query", "images");
+    for (int read_data = 0; read_data <= 1; read_data++) {
+        double files_total = 0, store_total = 0;
+        size_t files_found = 0, store_found = 0;
+        srand(1);
+        for (int q = 0; q < queries; q++) {
+            char robot[STORE_ROBOT_MAX];
+            robot_name(rand() % robots, robot, sizeof(robot));
+            int64_t from = base + (int64_t)((double)rand() / RAND_MAX * (span - window));
+
+            start = now_ns();
+            files_found += query_files(files_dir, robot, from, from + window, buffer, read_data);
+            files_total += now_ns() - start;
+
+            start = now_ns();
+            store_found += query_store(&store, robot, from, from + window, buffer, read_data);
+            store_total += now_ns() - start;
+        }
+        print_query(read_data ? "per-file + read" : "per-file", files_total, queries, files_found);
+        print_query(read_data ? "image_store + read" : "image_store", store_total, queries, store_found);
+    }
+    printf("\n加载索引: %.2f ms\n", load_elapsed / 1e6);
+
+    image_store_close(&store);
+    remove_dir(files_dir);
+    remove_dir(store_dir);
+    free(data);
+    free(buffer);
+    return 0;
+}
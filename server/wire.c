@@ -0,0 +1,418 @@
+#include <stddef.h>
+#include <string.h>
+#include "wire.h"
+#include "json_index.h"
+
+#define WIRE_STRING  1
+#define WIRE_INTEGER 2
+#define WIRE_BOOLEAN 3
+#define WIRE_FLAG    4  // 只出现在 JSON 中的协商标志
+
+// 字段描述，由 wire_messages.def 生成
+typedef struct {
+    const char *key;    // JSON 键
+    const char *json;   // JSON 中字段前的固定文本 "key":，标志字段还包括写出的值
+    uint8_t json_len;
+    uint8_t number;     // 紧凑编码的字段号，标志字段为0
+    uint8_t kind;
+    uint8_t flags;
+    uint16_t offset;    // 字段在 WireMessage 中的位置
+    const char *value;  // 标志字段的取值
+} WireField;
+
+// 消息描述。JSON 模板由开头的固定文本和各字段的固定文本组成，键名在编译期拼好，
+// 编码时只需拷贝文本并写出字段值
+typedef struct {
+    const char *tag;        // 识别键
+    const char *tag_value;  // 识别值，NULL 表示出现识别键即可
+    const char *prefix;     // JSON 开头的固定文本
+    uint8_t prefix_len;
+    uint8_t field_count;
+    const WireField *fields;
+} WireSchema;
+
+#define JSON_TEXT(text) text, sizeof(text) - 1
+
+#define MESSAGE(type, Struct, name, tag) static const WireField name##_fields[] = {
+#define TAGGED(type, Struct, name, tag, value) MESSAGE(type, Struct, name, tag)
+#define FIELD(name, member, number, key, kind, flags) \
+    { key, JSON_TEXT("\"" key "\":"), number, kind, flags, offsetof(WireMessage, name.member), NULL },
+#define STRING(name, member, number, key, flags) FIELD(name, member, number, key, WIRE_STRING, flags)
+#define INTEGER(name, member, number, key, flags) FIELD(name, member, number, key, WIRE_INTEGER, flags)
+#define BOOLEAN(name, member, number, key, flags) FIELD(name, member, number, key, WIRE_BOOLEAN, flags)
+#define FLAG(name, member, key, json, value) \
+    { key, JSON_TEXT("\"" key "\":" json), 0, WIRE_FLAG, WIRE_OPTIONAL, offsetof(WireMessage, name.member), value },
+#define END(Struct, name) };
+#include "wire_messages.def"
+#undef MESSAGE
+#undef TAGGED
+#undef STRING
+#undef INTEGER
+#undef BOOLEAN
+#undef FLAG
+#undef END
+
+// 以下几次展开只用到消息，字段展开为空
+#define STRING(name, member, number, key, flags)
+#define INTEGER(name, member, number, key, flags)
+#define BOOLEAN(name, member, number, key, flags)
+#define FLAG(name, member, key, json, value)
+#define END(Struct, name)
+
+#define FIELD_COUNT(name) (uint8_t)(sizeof(name##_fields) / sizeof(name##_fields[0]))
+#define MESSAGE(type, Struct, name, tag) \
+    [type] = { tag, NULL, JSON_TEXT("{"), FIELD_COUNT(name), name##_fields },
+#define TAGGED(type, Struct, name, tag, value) \
+    [type] = { tag, value, JSON_TEXT("{\"" tag "\":\"" value "\""), FIELD_COUNT(name), name##_fields },
+static const WireSchema wire_schema[] = {
+#include "wire_messages.def"
+};
+#undef MESSAGE
+#undef TAGGED
+
+#define WIRE_TYPE_COUNT (sizeof(wire_schema) / sizeof(wire_schema[0]))
+
+// 识别 JSON 消息时按 wire_messages.def 中的顺序尝试
+#define MESSAGE(type, Struct, name, tag) type,
+#define TAGGED(type, Struct, name, tag, value) type,
+static const uint8_t json_types[] = {
+#include "wire_messages.def"
+};
+#undef MESSAGE
+#undef TAGGED
+#undef STRING
+#undef INTEGER
+#undef BOOLEAN
+#undef FLAG
+#undef END
+
+static const WireSchema *find_schema(uint8_t type) {
+    if (type == 0 || type >= WIRE_TYPE_COUNT || !wire_schema[type].fields) {
+        return NULL;
+    }
+    return &wire_schema[type];
+}
+
+int wire_encode(const WireMessage *msg, uint8_t *out, size_t out_size) {
+    const WireSchema *schema = find_schema(msg->type);
+    if (!schema || out_size < 1) {
+        return -1;
+    }
+
+    size_t pos = 0;
+    out[pos++] = msg->type;
+    for (const WireField *field = schema->fields; field < schema->fields + schema->field_count; field++) {
+        const char *base = (const char *)msg + field->offset;
+        uint8_t buf[8];
+        const uint8_t *data;
+        size_t len;
+
+        if (field->kind == WIRE_FLAG) {
+            continue;
+        }
+        if (field->kind == WIRE_BOOLEAN && field->flags == WIRE_OMIT_EMPTY && !*(const int *)base) {
+            continue;
+        }
+        if (field->kind == WIRE_STRING) {
+            len = strlen(base);
+            if (len == 0) {
+                continue;
+            }
+            if (len > 255) {
+                return -1;
+            }
+            data = (const uint8_t *)base;
+        } else {
+            int64_t v = field->kind == WIRE_INTEGER ? *(const int64_t *)base : *(const int *)base != 0;
+            uint64_t zigzag = ((uint64_t)v << 1) ^ (uint64_t)(v >> 63);
+            len = 0;
+            while (len < 8 && (zigzag >> (8 * len))) {
+                len++;
+            }
+            for (size_t i = 0; i < len; i++) {
+                buf[i] = (uint8_t)(zigzag >> (8 * (len - 1 - i)));
+            }
+            data = buf;
+        }
+
+        if (pos + 2 + len > out_size) {
+            return -1;
+        }
+        out[pos++] = field->number;
+        out[pos++] = (uint8_t)len;
+        memcpy(out + pos, data, len);
+        pos += len;
+    }
+    return (int)pos;
+}
+
+// 按 cJSON 的规则转义字符串，返回写出的长度，缓冲区不足返回-1
+static int json_write_string(const char *text, char *out, size_t out_size) {
+    static const char hex[] = "0123456789abcdef";
+    size_t pos = 0;
+    if (out_size < 2) {
+        return -1;
+    }
+    out[pos++] = '"';
+    for (const unsigned char *p = (const unsigned char *)text; *p; p++) {
+        char escape = 0;
+        switch (*p) {
+            case '"':  escape = '"'; break;
+            case '\\': escape = '\\'; break;
+            case '\b': escape = 'b'; break;
+            case '\f': escape = 'f'; break;
+            case '\n': escape = 'n'; break;
+            case '\r': escape = 'r'; break;
+            case '\t': escape = 't'; break;
+        }
+        if (escape) {
+            if (pos + 2 >= out_size) {
+                return -1;
+            }
+            out[pos++] = '\\';
+            out[pos++] = escape;
+        } else if (*p < 32) {
+            if (pos + 6 >= out_size) {
+                return -1;
+            }
+            memcpy(out + pos, "\\u00", 4);
+            out[pos + 4] = hex[*p >> 4];
+            out[pos + 5] = hex[*p & 0xF];
+            pos += 6;
+        } else {
+            if (pos + 1 >= out_size) {
+                return -1;
+            }
+            out[pos++] = (char)*p;
+        }
+    }
+    out[pos++] = '"';
+    return (int)pos;
+}
+
+// 整数按十进制写出，与 cJSON 打印绝对值小于1e15的整数相同
+static int json_write_integer(int64_t value, char *out, size_t out_size) {
+    char digits[20];
+    size_t count = 0;
+    size_t pos = 0;
+    uint64_t magnitude = value < 0 ? 0 - (uint64_t)value : (uint64_t)value;
+    do {
+        digits[count++] = (char)('0' + magnitude % 10);
+        magnitude /= 10;
+    } while (magnitude);
+    if (count + 1 > out_size) {
+        return -1;
+    }
+    if (value < 0) {
+        out[pos++] = '-';
+    }
+    while (count) {
+        out[pos++] = digits[--count];
+    }
+    return (int)pos;
+}
+
+int wire_encode_json(const WireMessage *msg, char *out, size_t out_size) {
+    const WireSchema *schema = find_schema(msg->type);
+    if (!schema || out_size < schema->prefix_len) {
+        return -1;
+    }
+
+    size_t pos = schema->prefix_len;
+    memcpy(out, schema->prefix, pos);
+    for (const WireField *field = schema->fields; field < schema->fields + schema->field_count; field++) {
+        const char *base = (const char *)msg + field->offset;
+        if (field->kind == WIRE_FLAG && !*(const int *)base) {
+            continue;
+        }
+        if (field->flags == WIRE_OMIT_EMPTY &&
+            (field->kind == WIRE_STRING ? base[0] == '\0' : field->kind == WIRE_BOOLEAN && !*(const int *)base)) {
+            continue;
+        }
+
+        // 开头的固定文本之后都需要逗号
+        if (pos + 1 + field->json_len > out_size) {
+            return -1;
+        }
+        if (pos > 1) {
+            out[pos++] = ',';
+        }
+        memcpy(out + pos, field->json, field->json_len);
+        pos += field->json_len;
+
+        int len = 0;
+        if (field->kind == WIRE_STRING) {
+            len = json_write_string(base, out + pos, out_size - pos);
+        } else if (field->kind == WIRE_INTEGER) {
+            len = json_write_integer(*(const int64_t *)base, out + pos, out_size - pos);
+        } else if (field->kind == WIRE_BOOLEAN) {
+            const char *boolean = *(const int *)base ? "true" : "false";
+            len = (int)strlen(boolean);
+            if (pos + len > out_size) {
+                return -1;
+            }
+            memcpy(out + pos, boolean, len);
+        }
+        if (len < 0) {
+            return -1;
+        }
+        pos += len;
+    }
+    if (pos + 1 > out_size) {
+        return -1;
+    }
+    out[pos++] = '}';
+    return (int)pos;
+}
+
+int wire_decode(WireMessage *msg, const uint8_t *data, size_t len) {
+    memset(msg, 0, sizeof(*msg));
+    const WireSchema *schema = len >= 1 ? find_schema(data[0]) : NULL;
+    if (!schema) {
+        return -1;
+    }
+    msg->type = data[0];
+
+    size_t pos = 1;
+    while (pos < len) {
+        if (pos + 2 > len || pos + 2 + data[pos + 1] > len) {
+            return -1;
+        }
+        uint8_t number = data[pos];
+        size_t field_len = data[pos + 1];
+        const uint8_t *value = data + pos + 2;
+        pos += 2 + field_len;
+
+        const WireField *field = schema->fields;
+        while (field < schema->fields + schema->field_count && (field->number != number || number == 0)) {
+            field++;
+        }
+        if (field == schema->fields + schema->field_count) {
+            continue;  // 未知字段
+        }
+
+        char *base = (char *)msg + field->offset;
+        if (field->kind == WIRE_STRING) {
+            // 字段长度不超过255，缓冲区总能放下
+            memcpy(base, value, field_len);
+            base[field_len] = '\0';
+        } else {
+            if (field_len > 8) {
+                return -1;
+            }
+            uint64_t zigzag = 0;
+            for (size_t i = 0; i < field_len; i++) {
+                zigzag = (zigzag << 8) | value[i];
+            }
+            int64_t v = (int64_t)(zigzag >> 1) ^ -(int64_t)(zigzag & 1);
+            if (field->kind == WIRE_INTEGER) {
+                *(int64_t *)base = v;
+            } else {
+                *(int *)base = v != 0;
+            }
+        }
+        msg->fields |= (uint32_t)1 << number;
+    }
+
+    // 空字符串在紧凑编码中省略，只检查数值字段
+    for (const WireField *field = schema->fields; field < schema->fields + schema->field_count; field++) {
+        if (field->flags == WIRE_REQUIRED && field->kind != WIRE_STRING && field->kind != WIRE_FLAG &&
+            !WIRE_HAS(msg, field->number)) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+// 取整数值，不是整数或超出 int64 范围返回-1
+static int json_value_integer(const JsonValue *value, int64_t *integer) {
+    double number;
+    if (json_value_number(value, &number) < 0) {
+        return -1;
+    }
+    if (!(number >= -9223372036854775808.0 && number < 9223372036854775808.0) || number != (double)(int64_t)number) {
+        return -1;
+    }
+    *integer = (int64_t)number;
+    return 0;
+}
+
+// 协商标志：值为取值字符串，或是包含取值的数组
+static int json_value_flag(const JsonValue *value, const char *word) {
+    JsonValue item;
+    size_t cursor = 0;
+    if (json_value_equals(value, word)) {
+        return 1;
+    }
+    while (json_array_next(value, &cursor, &item)) {
+        if (json_value_equals(&item, word)) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+int wire_decode_json(WireMessage *msg, const char *json, size_t len) {
+    JsonIndex index;
+    memset(msg, 0, sizeof(*msg));
+    if (json_index_build(&index, json, len) < 0) {
+        return -1;
+    }
+
+    const WireSchema *schema = NULL;
+    for (size_t i = 0; i < sizeof(json_types) && !schema; i++) {
+        const WireSchema *candidate = &wire_schema[json_types[i]];
+        const JsonValue *tag = json_index_get(&index, candidate->tag);
+        if (candidate->tag_value ? json_value_equals(tag, candidate->tag_value) : tag != NULL) {
+            schema = candidate;
+            msg->type = json_types[i];
+        }
+    }
+    if (!schema) {
+        return 0;
+    }
+
+    for (const WireField *field = schema->fields; field < schema->fields + schema->field_count; field++) {
+        const JsonValue *value = json_index_get(&index, field->key);
+        char *base = (char *)msg + field->offset;
+        int ret = 0;
+
+        // null 视同缺省
+        if (!value || value->type == JSON_INDEX_NULL) {
+            if (field->flags == WIRE_REQUIRED) {
+                return -1;
+            }
+            continue;
+        }
+        switch (field->kind) {
+            case WIRE_STRING:
+                ret = json_value_string(value, base, WIRE_TEXT_MAX);
+                break;
+            case WIRE_INTEGER:
+                ret = json_value_integer(value, (int64_t *)base);
+                break;
+            case WIRE_BOOLEAN:
+                if (value->type != JSON_INDEX_TRUE && value->type != JSON_INDEX_FALSE) {
+                    return -1;
+                }
+                *(int *)base = value->type == JSON_INDEX_TRUE;
+                break;
+            case WIRE_FLAG:
+                *(int *)base = json_value_flag(value, field->value);
+                continue;
+        }
+        if (ret < 0) {
+            return -1;
+        }
+        msg->fields |= (uint32_t)1 << field->number;
+    }
+    return 0;
+}
+
+const char *wire_command_name(uint8_t type) {
+    const WireSchema *schema = find_schema(type);
+    if (!schema || !schema->tag_value || strcmp(schema->tag, "command") != 0) {
+        return NULL;
+    }
+    return schema->tag_value;
+}